@@ -1,20 +1,94 @@
 #ifndef SMOLJSON_HPP
 #define SMOLJSON_HPP
 
-#include <iomanip>
-#include <sstream>
 #include <stdexcept>
 #include <variant>
 #include <string>
 #include <string_view>
 #include <vector>
-#include <unordered_map>
 #include <memory>
 #include <algorithm>
 #include <type_traits>
 #include <cmath>
 #include <functional>
+#include <istream>
+#include <ostream>
 #include <array>
+#include <cstdint>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <optional>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <future>
+#include <thread>
+#include <atomic>
+#include <tuple>
+#include <limits>
+#include <regex>
+
+// every error smoljson reports by exception goes through this. builds with
+// -fno-exceptions abort instead, use the non-throwing api (parse with an
+// error&, find(), try_get(), get_or()) there. can be overridden before include
+#ifndef SMOLJSON_THROW
+	#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+		#define SMOLJSON_THROW(exception) throw exception
+	#else
+		#define SMOLJSON_THROW(exception) (static_cast<void>(sizeof(exception)), std::abort())
+	#endif
+#endif
+
+// field table for typed parsing and writing, at namespace scope next to the struct:
+//   struct person { std::string name; int age; };
+//   SMOLJSON_FIELDS(person, name, age)
+// defines a constexpr smoljson_fields() that smoljson finds by ADL. up to
+// 32 fields, the FOR_EACH helpers below are an implementation detail
+#define SMOLJSON_FIELD(type, name) smoljson::make_field(#name, "\"" #name "\":", &type::name)
+#define SMOLJSON_FIELDS(type, ...) \
+	constexpr auto smoljson_fields(const type*) { \
+		return std::make_tuple(SMOLJSON_FOR_EACH(SMOLJSON_FIELD, type, __VA_ARGS__)); \
+	}
+
+#define SMOLJSON_EXPAND(x) x
+#define SMOLJSON_FE_1(m, t, x) m(t, x)
+#define SMOLJSON_FE_2(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_1(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_3(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_2(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_4(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_3(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_5(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_4(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_6(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_5(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_7(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_6(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_8(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_7(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_9(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_8(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_10(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_9(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_11(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_10(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_12(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_11(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_13(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_12(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_14(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_13(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_15(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_14(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_16(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_15(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_17(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_16(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_18(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_17(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_19(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_18(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_20(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_19(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_21(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_20(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_22(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_21(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_23(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_22(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_24(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_23(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_25(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_24(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_26(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_25(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_27(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_26(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_28(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_27(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_29(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_28(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_30(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_29(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_31(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_30(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_32(m, t, x, ...) m(t, x), SMOLJSON_EXPAND(SMOLJSON_FE_31(m, t, __VA_ARGS__))
+#define SMOLJSON_FE_PICK(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, name, ...) name
+#define SMOLJSON_FOR_EACH(m, t, ...) \
+	SMOLJSON_EXPAND(SMOLJSON_FE_PICK(__VA_ARGS__, SMOLJSON_FE_32, SMOLJSON_FE_31, SMOLJSON_FE_30, SMOLJSON_FE_29, SMOLJSON_FE_28, SMOLJSON_FE_27, SMOLJSON_FE_26, SMOLJSON_FE_25, SMOLJSON_FE_24, SMOLJSON_FE_23, SMOLJSON_FE_22, SMOLJSON_FE_21, SMOLJSON_FE_20, SMOLJSON_FE_19, SMOLJSON_FE_18, SMOLJSON_FE_17, SMOLJSON_FE_16, SMOLJSON_FE_15, SMOLJSON_FE_14, SMOLJSON_FE_13, SMOLJSON_FE_12, SMOLJSON_FE_11, SMOLJSON_FE_10, SMOLJSON_FE_9, SMOLJSON_FE_8, SMOLJSON_FE_7, SMOLJSON_FE_6, SMOLJSON_FE_5, SMOLJSON_FE_4, SMOLJSON_FE_3, SMOLJSON_FE_2, SMOLJSON_FE_1)(m, t, __VA_ARGS__))
 
 class smoljson {
 
@@ -28,45 +102,374 @@ class smoljson {
 		return result;
 	}
 
-	template <typename Container, typename UnaryFunction>
-	static auto map_container(const Container& input, UnaryFunction func) {
-		std::vector<decltype(func(*input.begin()))> result(input.size());
-		std::transform(input.begin(), input.end(), result.begin(), func);
-		return result;
+	static constexpr std::array<std::string_view, 32> control_escapes = {
+		"\\u0000", "\\u0001", "\\u0002", "\\u0003", "\\u0004", "\\u0005", "\\u0006", "\\u0007",
+		"\\b",     "\\t",     "\\n",     "\\u000b", "\\f",     "\\r",     "\\u000e", "\\u000f",
+		"\\u0010", "\\u0011", "\\u0012", "\\u0013", "\\u0014", "\\u0015", "\\u0016", "\\u0017",
+		"\\u0018", "\\u0019", "\\u001a", "\\u001b", "\\u001c", "\\u001d", "\\u001e", "\\u001f"
+	};
+
+	// number conversion without exceptions. the whole text has to be a
+	// json number, or with allow_partial anything std::stod takes: leading
+	// whitespace, a '+', hex, inf and nan, and a prefix is enough. out of
+	// range fails either way
+	static bool to_number(std::string_view text, double& out, bool allow_partial) {
+		if (text.empty()) return false;
+#if defined(__cpp_lib_to_chars)
+		if (!allow_partial) {
+			auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+			return ec == std::errc() && end == text.data() + text.size();
+		}
+#endif
+		char small[64];
+		std::string large;
+		const char* cstr = small;
+		if (text.size() < sizeof(small)) {
+			std::memcpy(small, text.data(), text.size());
+			small[text.size()] = '\0';
+		} else {
+			large.assign(text);
+			cstr = large.c_str();
+		}
+		char* end = nullptr;
+		errno = 0;
+		out = std::strtod(cstr, &end);
+		return end != cstr && errno != ERANGE && (allow_partial || end == cstr + text.size());
 	}
 
-	static std::string join(const std::vector<std::string>& vec, const std::string& sep) {
-		if (vec.empty()) return "";
-		size_t prealloc = vec[0].size();
+	// swar: nonzero if any of the 8 bytes in x is below n (n <= 128) or equal to b
+	static constexpr uint64_t swar_ones = ~uint64_t(0) / 255;
+	static uint64_t swar_has_less(uint64_t x, uint8_t n) { return (x - swar_ones * n) & ~x & swar_ones * 128; }
+	static uint64_t swar_has_byte(uint64_t x, uint8_t b) { return swar_has_less(x ^ (swar_ones * b), 1); }
 
-		for (size_t i = 1; i < vec.size(); i++) {
-			prealloc += sep.size() + vec[i].size();
+	// hex digit to value, -1 for everything else
+	static constexpr std::array<int8_t, 256> hex_table = [] {
+		std::array<int8_t, 256> table{};
+		for (auto& v : table) v = -1;
+		for (int c = 0; c < 10; c++) table['0' + c] = static_cast<int8_t>(c);
+		for (int c = 0; c < 6; c++) {
+			table['a' + c] = static_cast<int8_t>(10 + c);
+			table['A' + c] = static_cast<int8_t>(10 + c);
 		}
-		
-		std::string result;
-		result.reserve(prealloc);
+		return table;
+	}();
 
-		result.append(vec[0]);
+	// the 4 hex digits of a \u escape, -1 if one of them is not a digit
+	static int32_t hex4(const char* p) {
+		int32_t a = hex_table[static_cast<unsigned char>(p[0])], b = hex_table[static_cast<unsigned char>(p[1])];
+		int32_t c = hex_table[static_cast<unsigned char>(p[2])], d = hex_table[static_cast<unsigned char>(p[3])];
+		if ((a | b | c | d) < 0) return -1;
+		return (a << 12) | (b << 8) | (c << 4) | d;
+	}
 
-		for (size_t i = 1; i < vec.size(); i++) {
-			result.append(sep);
-			result.append(vec[i]);
+	static void append_utf8(std::string& out, uint32_t cp) {
+		if (cp < 0x80) {
+			out += static_cast<char>(cp);
+		} else if (cp < 0x800) {
+			char buf[2] = { static_cast<char>(0xC0 | (cp >> 6)), static_cast<char>(0x80 | (cp & 0x3F)) };
+			out.append(buf, 2);
+		} else if (cp < 0x10000) {
+			char buf[3] = { static_cast<char>(0xE0 | (cp >> 12)), static_cast<char>(0x80 | ((cp >> 6) & 0x3F)), static_cast<char>(0x80 | (cp & 0x3F)) };
+			out.append(buf, 3);
+		} else {
+			char buf[4] = { static_cast<char>(0xF0 | (cp >> 18)), static_cast<char>(0x80 | ((cp >> 12) & 0x3F)),
+				static_cast<char>(0x80 | ((cp >> 6) & 0x3F)), static_cast<char>(0x80 | (cp & 0x3F)) };
+			out.append(buf, 4);
 		}
-
-		return result;
 	}
 
-	static constexpr std::array<const char*, 32> control_escapes = {
-		"\\u0000", "\\u0001", "\\u0002", "\\u0003", "\\u0004", "\\u0005", "\\u0006", "\\u0007",
-		"\\b",     "\\t",     "\\n",     "\\u000b", "\\f",     "\\r",     "\\u000e", "\\u000f",
-		"\\u0010", "\\u0011", "\\u0012", "\\u0013", "\\u0014", "\\u0015", "\\u0016", "\\u0017",
-		"\\u0018", "\\u0019", "\\u001a", "\\u001b", "\\u001c", "\\u001d", "\\u001e", "\\u001f"
-	};
+	// length of the multi-byte utf-8 sequence at p (avail bytes left), 0 if
+	// it is invalid: overlongs, surrogates and anything past U+10FFFF
+	static size_t utf8_sequence(const char* p, size_t avail) {
+		auto byte = [&](size_t k) { return k < avail ? static_cast<unsigned char>(p[k]) : 0u; };
+		auto cont = [&](size_t k, unsigned lo = 0x80, unsigned hi = 0xBF) { unsigned b = byte(k); return b >= lo && b <= hi; };
+		unsigned lead = byte(0);
+		if (lead >= 0xC2 && lead <= 0xDF) return cont(1) ? 2 : 0;
+		if (lead == 0xE0) return cont(1, 0xA0) && cont(2) ? 3 : 0;
+		if (lead == 0xED) return cont(1, 0x80, 0x9F) && cont(2) ? 3 : 0;
+		if (lead >= 0xE1 && lead <= 0xEF) return cont(1) && cont(2) ? 3 : 0;
+		if (lead == 0xF0) return cont(1, 0x90) && cont(2) && cont(3) ? 4 : 0;
+		if (lead >= 0xF1 && lead <= 0xF3) return cont(1) && cont(2) && cont(3) ? 4 : 0;
+		if (lead == 0xF4) return cont(1, 0x80, 0x8F) && cont(2) && cont(3) ? 4 : 0;
+		return 0;
+	}
 
 	// hack to get template instatiation that failed
 	template<typename> static inline constexpr bool always_false_v = false;
 
-	using object_t = std::unordered_map<std::string, std::unique_ptr<smoljson>>;
+	// containers that get<T>() and the constructors convert in bulk
+	template<typename> struct container_traits { static constexpr bool sequence = false, mapping = false; };
+	template<typename T, typename A> struct container_traits<std::vector<T, A>> {
+		static constexpr bool sequence = true, mapping = false, fixed_size = false;
+		using element = T;
+	};
+	template<typename T, size_t N> struct container_traits<std::array<T, N>> {
+		static constexpr bool sequence = true, mapping = false, fixed_size = true;
+		using element = T;
+	};
+	template<typename T, typename H, typename E, typename A> struct container_traits<std::unordered_map<std::string, T, H, E, A>> {
+		static constexpr bool sequence = false, mapping = true, reservable = true;
+		using element = T;
+	};
+	template<typename T, typename C, typename A> struct container_traits<std::map<std::string, T, C, A>> {
+		static constexpr bool sequence = false, mapping = true, reservable = false;
+		using element = T;
+	};
+	template<typename> struct is_optional : std::false_type {};
+	template<typename T> struct is_optional<std::optional<T>> : std::true_type {};
+	template<typename> struct is_unique_ptr : std::false_type {};
+	template<typename T> struct is_unique_ptr<std::unique_ptr<T>> : std::true_type {};
+
+	/// OUTPUT SINKS
+
+	// serialization is written against these so that serialize(),
+	// serialized_size() and serialize_to() all share one code path
+
+	struct string_sink {
+		std::string& out;
+		void put(char c) { out.push_back(c); }
+		void write(const char* data, size_t len) { out.append(data, len); }
+	};
+
+	struct counting_sink {
+		size_t count = 0;
+		void put(char) { ++count; }
+		void write(const char*, size_t len) { count += len; }
+	};
+
+	struct buffer_sink {
+		char* cur;
+		char* end;
+
+		void put(char c) {
+			if (cur == end) SMOLJSON_THROW(std::length_error("Buffer too small for serialized json"));
+			*cur++ = c;
+		}
+
+		void write(const char* data, size_t len) {
+			if (static_cast<size_t>(end - cur) < len) SMOLJSON_THROW(std::length_error("Buffer too small for serialized json"));
+			std::memcpy(cur, data, len);
+			cur += len;
+		}
+	};
+
+	static constexpr size_t max_number_chars = 32;
+
+	// writes the shortest representation we emit for a number into buf
+	// and returns its length. whole numbers are printed as integers as
+	// long as they fit into a long long, everything else uses %.15g
+	static size_t format_number(double dbl, char* buf) {
+		if (std::floor(dbl) == dbl && std::fabs(dbl) < 1e18) { // value is whole integer
+			return std::to_chars(buf, buf + max_number_chars, static_cast<long long>(dbl)).ptr - buf;
+		}
+		return static_cast<size_t>(std::snprintf(buf, max_number_chars, "%.15g", dbl));
+	}
+
+	template<typename Sink>
+	static void write_number(Sink& out, double dbl) {
+		char buf[max_number_chars];
+		out.write(buf, format_number(dbl, buf));
+	}
+
+	// writes s as a quoted json string. runs of characters that need no
+	// escaping are written in one go instead of char by char
+	template<typename Sink>
+	static void write_escaped(Sink& out, std::string_view s) {
+		out.put('"');
+		size_t run = 0;
+		for (size_t i = 0; i < s.size(); i++) {
+			unsigned char c = s[i];
+			if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+			out.write(s.data() + run, i - run);
+			if (c < 0x20) {
+				out.write(control_escapes[c].data(), control_escapes[c].size());
+			} else {
+				out.put('\\'); // add escaping backslash for \ and "
+				out.put(c);
+			}
+			run = i + 1;
+		}
+		out.write(s.data() + run, s.size() - run);
+		out.put('"');
+	}
+
+	/// OBJECT STORAGE
+
+	static constexpr uint64_t hash_mum(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+		__extension__ using uint128_t = unsigned __int128;
+		uint128_t r = static_cast<uint128_t>(a) * b;
+		return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+#else
+		uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+		uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+		uint64_t lo = t + (rm1 << 32);
+		uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+		return lo ^ hi;
+#endif
+	}
+
+	// little endian load of n <= 8 bytes, written as a loop so it stays
+	// constexpr. compilers fold it into a single load at runtime
+	static constexpr uint64_t hash_read(const char* p, size_t n) {
+		uint64_t v = 0;
+		for (size_t i = 0; i < n; i++) v |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+		return v;
+	}
+
+	// wyhash style hash for object keys. constexpr so keys can be hashed
+	// at compile time and looked up without hashing at runtime
+	static constexpr uint64_t hash_key(std::string_view key, uint64_t seed = 0) {
+		constexpr uint64_t k0 = 0xa0761d6478bd642full, k1 = 0xe7037ed1a0b428dbull;
+		const char* p = key.data();
+		size_t len = key.size();
+		seed ^= hash_mum(seed ^ k0, k1);
+
+		uint64_t a = 0, b = 0;
+		if (len <= 16) {
+			if (len >= 4) {
+				size_t mid = (len >> 3) << 2;
+				a = (hash_read(p, 4) << 32) | hash_read(p + mid, 4);
+				b = (hash_read(p + len - 4, 4) << 32) | hash_read(p + len - 4 - mid, 4);
+			} else if (len > 0) {
+				a = (hash_read(p, 1) << 16) | (hash_read(p + (len >> 1), 1) << 8) | hash_read(p + len - 1, 1);
+			}
+		} else {
+			size_t i = 0;
+			for (; len - i > 16; i += 16) {
+				seed = hash_mum(hash_read(p + i, 8) ^ k1, hash_read(p + i + 8, 8) ^ seed);
+			}
+			a = hash_read(p + len - 16, 8);
+			b = hash_read(p + len - 8, 8);
+		}
+		return hash_mum(k1 ^ len, hash_mum(a ^ k1, b ^ seed));
+	}
+
+	// insertion ordered hash map used for objects. entries are kept in a
+	// vector in the order they were added (which is also the order they are
+	// serialized in). the index is an open addressing table with linear
+	// probing that stores the upper 32 bits of hash_key() and the entry
+	// position. lookups take a string_view, so no temporary std::string is
+	// built, and there are overloads taking an already computed hash
+	class object_map {
+	public:
+		using value_type = std::pair<std::string, std::unique_ptr<smoljson>>;
+		using iterator = typename std::vector<value_type>::iterator;
+		using const_iterator = typename std::vector<value_type>::const_iterator;
+
+	private:
+		static constexpr size_t npos = static_cast<size_t>(-1);
+
+		struct slot {
+			uint32_t tag;   // upper 32 bits of the hash, its top bits pick the home slot
+			uint32_t index; // entry position + 1, 0 marks an empty slot
+		};
+
+		std::vector<value_type> entries;
+		std::vector<slot> slots; // power of two sized, at most half full
+		uint32_t shift = 0;      // home slot is tag >> shift
+
+		static uint32_t tag_of(uint64_t hash) { return static_cast<uint32_t>(hash >> 32); }
+
+		size_t find_index(std::string_view key, uint64_t hash) const {
+			if (slots.empty()) return npos;
+			uint32_t tag = tag_of(hash);
+			size_t mask = slots.size() - 1;
+			for (size_t pos = tag >> shift; ; pos = (pos + 1) & mask) {
+				const slot& s = slots[pos];
+				if (s.index == 0) return npos;
+				if (s.tag == tag && entries[s.index - 1].first == key) return s.index - 1;
+			}
+		}
+
+		void place(slot s) {
+			size_t mask = slots.size() - 1;
+			size_t pos = s.tag >> shift;
+			while (slots[pos].index != 0) pos = (pos + 1) & mask;
+			slots[pos] = s;
+		}
+
+		// rebuilds the index for count entries, skipping/renumbering the
+		// entry at removed (if any) so erase() can reuse it
+		void rebuild(size_t count, size_t removed = npos) {
+			size_t size = 8;
+			uint32_t bits = 3;
+			while (size < count * 2) { size <<= 1; ++bits; }
+
+			std::vector<slot> old = std::move(slots);
+			slots.assign(size, slot{0, 0});
+			shift = 32 - bits;
+
+			for (slot s : old) {
+				if (s.index == 0 || s.index - 1 == removed) continue;
+				if (removed != npos && s.index - 1 > removed) --s.index;
+				place(s);
+			}
+		}
+
+	public:
+		iterator begin() { return entries.begin(); }
+		iterator end() { return entries.end(); }
+		const_iterator begin() const { return entries.begin(); }
+		const_iterator end() const { return entries.end(); }
+
+		size_t size() const { return entries.size(); }
+		bool empty() const { return entries.empty(); }
+
+		void reserve(size_t count) {
+			entries.reserve(count);
+			if (count > 0 && count * 2 > slots.size()) rebuild(count);
+		}
+
+		void clear() {
+			entries.clear();
+			slots.clear();
+		}
+
+		iterator find(std::string_view key, uint64_t hash) {
+			size_t index = find_index(key, hash);
+			return index == npos ? entries.end() : entries.begin() + index;
+		}
+
+		const_iterator find(std::string_view key, uint64_t hash) const {
+			size_t index = find_index(key, hash);
+			return index == npos ? entries.end() : entries.begin() + index;
+		}
+
+		iterator find(std::string_view key) { return find(key, hash_key(key)); }
+		const_iterator find(std::string_view key) const { return find(key, hash_key(key)); }
+
+		size_t count(std::string_view key) const { return find_index(key, hash_key(key)) == npos ? 0 : 1; }
+		bool contains(std::string_view key) const { return count(key) != 0; }
+
+		// appends a key that is known not to be present yet
+		iterator insert_new(std::string key, uint64_t hash, std::unique_ptr<smoljson> value) {
+			if ((entries.size() + 1) * 2 > slots.size()) rebuild(entries.size() + 1);
+			entries.emplace_back(std::move(key), std::move(value));
+			place(slot{tag_of(hash), static_cast<uint32_t>(entries.size())});
+			return entries.end() - 1;
+		}
+
+		// like std::unordered_map::emplace, keeps the existing value if key is present
+		std::pair<iterator, bool> emplace(std::string key, std::unique_ptr<smoljson> value) {
+			uint64_t hash = hash_key(key);
+			size_t index = find_index(key, hash);
+			if (index != npos) return { entries.begin() + index, false };
+			return { insert_new(std::move(key), hash, std::move(value)), true };
+		}
+
+		// keeps the order of the remaining entries, so this is O(size)
+		size_t erase(std::string_view key) {
+			size_t index = find_index(key, hash_key(key));
+			if (index == npos) return 0;
+			entries.erase(entries.begin() + index);
+			rebuild(entries.size(), index);
+			return 1;
+		}
+	};
+
+	using object_t = object_map;
 	using array_t = std::vector<smoljson>;
 
 	// DATA MEMBERS
@@ -80,7 +483,8 @@ class smoljson {
 		OBJECT
 	} type;
 
-	std::variant<
+	// mutable only so lazy leaves can be decoded on first read, see decode()
+	mutable std::variant<
 		std::monostate,
 		std::string,
 		double,
@@ -89,6 +493,185 @@ class smoljson {
 		object_t
 	> value;
 
+	// serialized text or source slice of a node, defined next to the parser
+	struct cached_text;
+
+	// opt-in serialization cache, see enable_serialize_cache(). set on the
+	// whole tree when enabled, containers added later pick it up the first
+	// time they are written
+	mutable bool caching = false;
+	mutable std::unique_ptr<cached_text> cached;
+
+	// nodes have no parent links, and a reference taken before a serialize
+	// can write below a container that cached its text since. so every
+	// write to a caching node takes a stamp from one counter, and a cache is
+	// only reused while nothing below it has a newer stamp than the cache
+	static inline std::atomic<uint64_t> edit_count{0};
+	uint64_t modified = 0;
+
+	void touch() {
+		if (caching) modified = edit_count.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+
+	// every mutating access goes through the node's non-const accessors or
+	// assignment, ancestors holding text see the stamp, see cache_is_fresh()
+	void invalidate_cache() {
+		decode(); // a lazy leaf loses its slice, so it needs its value first
+		cached.reset();
+		touch();
+	}
+
+	// nothing below this node was written after since. lazy nodes can't
+	// have been, and a cache checked against the current count vouches for
+	// its whole subtree
+	bool unchanged_since(uint64_t since) const {
+		if (modified > since) return false;
+		if (is_lazy()) return true;
+		if (cached && !cached->source && cached->generation == edit_count.load(std::memory_order_relaxed)) return true;
+		if (type == ARRAY) {
+			for (const smoljson& item : std::get<array_t>(value)) {
+				if (!item.unchanged_since(since)) return false;
+			}
+		} else if (type == OBJECT) {
+			for (const auto& [key, val_ptr] : std::get<object_t>(value)) {
+				if (!val_ptr->unchanged_since(since)) return false;
+			}
+		}
+		return true;
+	}
+
+	// source slices are dropped on the way down to any write, only text the
+	// cache formatted can go stale through an older reference
+	bool cache_is_fresh() const {
+		if (cached->source) return true;
+		uint64_t now = edit_count.load(std::memory_order_relaxed);
+		if (cached->generation == now) return true;
+		if (!unchanged_since(cached->generation)) return false;
+		cached->generation = now; // checked, the next serialize is O(1) again
+		return true;
+	}
+
+	// strings and numbers parsed with lazy_scalars and containers below
+	// eager_depth only have their source slice until the first read. the
+	// slice stays for serialize() and source_text() until the node is modified
+	bool is_lazy() const { return type != NULL_TYPE && type != BOOLEAN && value.index() == 0; }
+
+	void decode() const {
+		if (!is_lazy()) return;
+		std::string_view text = cached->text;
+		if (type == ARRAY || type == OBJECT) {
+			parser::expand(*this);
+		} else if (type == NUMBER) {
+			double number = 0;
+			to_number(text, number, false);
+			value = number;
+		} else if (!cached->escaped) {
+			value = std::string(text.substr(1, text.size() - 2));
+		} else {
+			value = parser::decode_string(text);
+		}
+	}
+
+	const std::string& string_value() const { decode(); return std::get<std::string>(value); }
+	double number_value() const { decode(); return std::get<double>(value); }
+	const array_t& array_value() const { decode(); return std::get<array_t>(value); }
+	const object_t& object_value() const { decode(); return std::get<object_t>(value); }
+
+	// serializes this node into any of the sinks above
+	template<typename Sink>
+	void write_json(Sink& out) const {
+		if (cached && !cache_is_fresh()) cached.reset();
+		if (cached) {
+			out.write(cached->text.data(), cached->text.size());
+			return;
+		}
+
+		if (caching && (type == ARRAY || type == OBJECT)) {
+			auto text = std::make_unique<cached_text>();
+			text->generation = edit_count.load(std::memory_order_relaxed);
+			string_sink sink{text->owned};
+			write_value(sink);
+			text->text = text->owned;
+			out.write(text->text.data(), text->text.size());
+			cached = std::move(text);
+			return;
+		}
+
+		write_value(out);
+	}
+
+	template<typename Sink>
+	void write_value(Sink& out) const {
+		switch (type) {
+			case NULL_TYPE: out.write("null", 4); break;
+			case STRING: write_escaped(out, std::get<std::string>(value)); break;
+			case NUMBER: write_number(out, std::get<double>(value)); break;
+			case BOOLEAN: std::get<bool>(value) ? out.write("true", 4) : out.write("false", 5); break;
+			case ARRAY: {
+				out.put('[');
+				bool first = true;
+				for (const smoljson& item : array_value()) {
+					if (!first) out.put(',');
+					first = false;
+					if (caching && !item.caching) item.caching = true; // no writes at all with the cache off
+					item.write_json(out);
+				}
+				out.put(']');
+				break;
+			}
+			case OBJECT: {
+				out.put('{');
+				bool first = true;
+				for (const auto& [key, val_ptr] : object_value()) {
+					if (!first) out.put(',');
+					first = false;
+					write_escaped(out, key);
+					out.put(':');
+					if (caching && !val_ptr->caching) val_ptr->caching = true;
+					val_ptr->write_json(out);
+				}
+				out.put('}');
+				break;
+			}
+		}
+	}
+
+	// object member lookup shared by the string_view and key overloads
+	smoljson& member(std::string_view key, uint64_t hash) {
+		invalidate_cache();
+		if (type != OBJECT) {
+			type = OBJECT;
+			value = object_t{};
+		}
+
+		auto& map = std::get<object_t>(value);
+		auto it = map.find(key, hash);
+
+		if (it == map.end()) {
+			it = map.insert_new(std::string(key), hash, std::make_unique<smoljson>());
+		}
+
+		return *(it->second);
+	}
+
+	const smoljson& member(std::string_view key, uint64_t hash) const {
+		if (type != OBJECT) {
+			SMOLJSON_THROW(std::runtime_error("Attempted to access non-object as object"));
+		}
+		const smoljson* found = find_member(key, hash);
+		if (!found) {
+			SMOLJSON_THROW(std::out_of_range("Key not found in object"));
+		}
+		return *found;
+	}
+
+	const smoljson* find_member(std::string_view key, uint64_t hash) const {
+		if (type != OBJECT) return nullptr;
+		const auto& map = object_value();
+		auto it = map.find(key, hash);
+		return it == map.end() ? nullptr : it->second.get();
+	}
+
 public:
 
 	/// CONSTRUCTORS	
@@ -102,13 +685,60 @@ public:
 	template<typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
 	smoljson(T num) : type(NUMBER), value(static_cast<double>(num)) {}
 
+	// std::vector, std::array, std::map/std::unordered_map with string
+	// keys and std::optional (nullopt is null), element by element
+	template<typename T, typename = std::enable_if_t<container_traits<T>::sequence>, typename = void>
+	smoljson(const T& items) : type(ARRAY), value(array_t{}) {
+		array_t& arr = std::get<array_t>(value);
+		arr.reserve(items.size());
+		for (const auto& item : items) arr.emplace_back(item);
+	}
+
+	template<typename T, typename = std::enable_if_t<container_traits<T>::mapping>, typename = void, typename = void>
+	smoljson(const T& items) : type(OBJECT), value(object_t{}) {
+		object_t& map = std::get<object_t>(value);
+		map.reserve(items.size());
+		for (const auto& [k, v] : items) map.insert_new(k, hash_key(k), std::make_unique<smoljson>(v)); // keys are unique already
+	}
+
+	template<typename T>
+	smoljson(const std::optional<T>& opt) : smoljson() {
+		if (opt) *this = smoljson(*opt);
+	}
+
 	smoljson(const smoljson& other) { *this = other; }
 	smoljson(smoljson&&) noexcept = default;
 
+	// a node that lives in a cached tree stays in it, and the write is
+	// stamped so ancestors holding text notice it
+	smoljson& operator=(smoljson&& other) noexcept {
+		if (this == &other) return *this;
+		// taken out first, other may live below this node
+		json_type moved_type = other.type;
+		auto moved_value = std::move(other.value);
+		auto moved_cached = std::move(other.cached);
+		caching = caching || other.caching;
+		type = moved_type;
+		value = std::move(moved_value);
+		cached = std::move(moved_cached);
+		touch();
+		return *this;
+	}
+
 	smoljson& operator=(const smoljson& other) {
 		if (this == &other) return *this;
 
 		type = other.type;
+		caching = caching || other.caching;
+		touch();
+		cached.reset(); // the old value is overwritten anyway, no decode()
+		if (other.cached && other.cached->source) { // verbatim slices stay valid
+			cached = std::make_unique<cached_text>(*other.cached);
+		}
+		if (other.is_lazy()) { // stays undecoded, the slice was copied above
+			value = std::monostate{};
+			return *this;
+		}
 
 		switch (type) {
 			case NULL_TYPE: value = std::monostate{}; break;
@@ -156,13 +786,19 @@ public:
 
 	/// ASSIGNMENT
 
+	// the old value is replaced as a whole, so a lazy source is dropped
+	// without decoding (or failing to expand) it first
 	smoljson& operator=(std::nullptr_t) {
+		cached.reset();
+		touch();
 		type = NULL_TYPE;
 		value = std::monostate{};
 		return *this;
 	}
 
 	smoljson& operator=(const std::string& s) {
+		cached.reset();
+		touch();
 		type = STRING;
 		value = s;
 		return *this;
@@ -173,6 +809,8 @@ public:
 	}
 
 	smoljson& operator=(bool b) {
+		cached.reset();
+		touch();
 		type = BOOLEAN;
 		value = b;
 		return *this;
@@ -180,42 +818,37 @@ public:
 
 	template<typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
 	smoljson& operator=(T num) {
+		cached.reset();
+		touch();
 		type = NUMBER;
 		value = static_cast<double>(num);
 		return *this;
 	}
 
-	/// ACCESSORS
+	/// KEYS
 
-	smoljson& operator[](const std::string& key) {
-	if (type != OBJECT) {
-			type = OBJECT;
-			value = object_t{};
-		}
+	// object key with its hash computed at compile time (guaranteed for
+	// constexpr variables), operator[] then only probes the index and
+	// compares the key bytes:
+	//   static constexpr smoljson::key name("name");
+	//   using namespace smoljson_literals; j["name"_key]
+	struct key {
+		std::string_view name;
+		uint64_t hash;
 
-		auto& map = std::get<object_t>(value);
-		auto it = map.find(key);
+		constexpr explicit key(std::string_view k) : name(k), hash(hash_key(k)) {}
+	};
 
-		if (it == map.end()) {
-			it = map.emplace(key, std::make_unique<smoljson>()).first;
-		}
+	/// ACCESSORS
 
-		return *(it->second);
-	}
-	
-	const smoljson& operator[](const std::string& key) const {
-		if (type != OBJECT) {
-			throw std::runtime_error("Attempted to access non-object as object");
-		}
-		const auto& map = std::get<object_t>(value);
-		auto it = map.find(key);
-		if (it == map.end()) {
-			throw std::out_of_range("Key not found in object");
-		}
-		return *(it->second);
-	}
+	smoljson& operator[](std::string_view key) { return member(key, hash_key(key)); }
+	smoljson& operator[](const key& k) { return member(k.name, k.hash); }
+
+	const smoljson& operator[](std::string_view key) const { return member(key, hash_key(key)); }
+	const smoljson& operator[](const key& k) const { return member(k.name, k.hash); }
 
 	smoljson& operator[](size_t index) {
+		invalidate_cache();
 		if (type != ARRAY) {
 			type = ARRAY;
 			value = array_t{};
@@ -232,13 +865,13 @@ public:
 	
 	const smoljson& operator[](size_t index) const {
 		if (type != ARRAY) {
-			throw std::runtime_error("Attempted to access non-array as array");
+			SMOLJSON_THROW(std::runtime_error("Attempted to access non-array as array"));
 		}
 
-		auto& arr = std::get<array_t>(value);
+		auto& arr = array_value();
 
 		if (index >= arr.size()) {
-			throw std::out_of_range("index out of bounds");
+			SMOLJSON_THROW(std::out_of_range("index out of bounds"));
 		}
 
 		return arr[index];
@@ -249,10 +882,10 @@ public:
 		if constexpr (std::is_same_v<T, bool>) {
 			switch (type) {
 				case BOOLEAN: return std::get<bool>(value);
-				case NUMBER: return std::get<double>(value) != 0.0;
+				case NUMBER: return number_value() != 0.0;
 				case NULL_TYPE: return false;
 				case STRING: {
-					auto& str = std::get<std::string>(value);
+					auto& str = string_value();
 					return !str.empty() && str != "false" && str != "0";
 				}
 				default: return true; // array/object: treat as truthy
@@ -261,23 +894,54 @@ public:
 		else if constexpr (std::is_arithmetic_v<T>) {
 			switch (type) {
 				case BOOLEAN: return static_cast<T>(std::get<bool>(value) ? 1 : 0);
-				case NUMBER: return static_cast<T>(std::get<double>(value));
+				case NUMBER: return static_cast<T>(number_value());
 				case STRING: {
-					try {
-						return static_cast<T>(std::stod(std::get<std::string>(value)));
-					} catch (...) {
-						return static_cast<T>(0); // or throw, based on preference
-					}
+					double number = 0;
+					return to_number(string_value(), number, true) ? static_cast<T>(number) : static_cast<T>(0);
 				}
 				default: return static_cast<T>(0);
 			}
 		}
 		else if constexpr (std::is_same_v<T, std::string>) {
 			switch (type) {
-				case STRING: return std::get<std::string>(value);
+				case STRING: return string_value();
 				default: return serialize();
 			}
 		}
+		else if constexpr (std::is_same_v<T, std::string_view>) {
+			// a view can't point at a serialized temporary, non-strings are empty
+			return type == STRING ? std::string_view(string_value()) : std::string_view();
+		}
+		else if constexpr (container_traits<T>::sequence) {
+			// wrong types give an empty container, missing std::array slots stay value-initialized
+			using element = typename container_traits<T>::element;
+			T result{};
+			if (type != ARRAY) return result;
+			const array_t& arr = array_value();
+			if constexpr (container_traits<T>::fixed_size) {
+				size_t count = std::min(arr.size(), result.size());
+				for (size_t i = 0; i < count; ++i) result[i] = arr[i].get<element>();
+			} else {
+				result.reserve(arr.size());
+				for (const smoljson& item : arr) result.push_back(item.get<element>());
+			}
+			return result;
+		}
+		else if constexpr (container_traits<T>::mapping) {
+			using element = typename container_traits<T>::element;
+			T result;
+			if (type != OBJECT) return result;
+			const object_t& map = object_value();
+			if constexpr (container_traits<T>::reservable) {
+				result.reserve(map.size());
+			}
+			for (const auto& [k, val_ptr] : map) result.emplace(k, val_ptr->template get<element>());
+			return result;
+		}
+		else if constexpr (is_optional<T>::value) {
+			if (type == NULL_TYPE) return std::nullopt;
+			return get<typename T::value_type>();
+		}
 		else {
 			static_assert(always_false_v<T>, "get<T>() is not implemented for this type");
 		}
@@ -287,269 +951,3562 @@ public:
 	T strict_get() const {
 		if constexpr (std::is_same_v<T, bool>) {
 			if (type != BOOLEAN)
-				throw std::runtime_error("Attempted to access non-boolean as boolean");
+				SMOLJSON_THROW(std::runtime_error("Attempted to access non-boolean as boolean"));
 			return std::get<bool>(value);
 		} else if constexpr (std::is_arithmetic_v<T>) {
 			if (type != NUMBER)
-				throw std::runtime_error("Attempted to access non-number as number");
-			return static_cast<T>(std::get<double>(value));
-		} else if constexpr (std::is_same_v<T, std::string>) {
+				SMOLJSON_THROW(std::runtime_error("Attempted to access non-number as number"));
+			return static_cast<T>(number_value());
+		} else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>) {
 			if (type != STRING)
-				throw std::runtime_error("Attempted to access non-string as string");
-			return std::get<std::string>(value);
+				SMOLJSON_THROW(std::runtime_error("Attempted to access non-string as string"));
+			return T(string_value());
 		} else {
 			static_assert(always_false_v<T>, "get<T>() is not implemented for this type");
 		}
 	}
 
+	// reference to the stored string, no copy. throws like strict_get()
+	template<typename T>
+	T get_ref() const {
+		static_assert(std::is_same_v<T, const std::string&>, "get_ref<T>() only supports const std::string&");
+		if (type != STRING)
+			SMOLJSON_THROW(std::runtime_error("Attempted to access non-string as string"));
+		return string_value();
+	}
+
+	template<typename T>
+	T get_ref() {
+		static_assert(std::is_same_v<T, const std::string&> || std::is_same_v<T, std::string&>,
+			"get_ref<T>() only supports const std::string& and std::string&");
+		if (type != STRING)
+			SMOLJSON_THROW(std::runtime_error("Attempted to access non-string as string"));
+		decode();
+		if constexpr (!std::is_const_v<std::remove_reference_t<T>>) invalidate_cache();
+		return std::get<std::string>(value);
+	}
+
+	// strict_get() that returns nullopt instead of throwing on a type mismatch
+	template<typename T>
+	std::optional<T> try_get() const {
+		if constexpr (std::is_same_v<T, bool>) {
+			if (type != BOOLEAN) return std::nullopt;
+			return std::get<bool>(value);
+		} else if constexpr (std::is_arithmetic_v<T>) {
+			if (type != NUMBER) return std::nullopt;
+			return static_cast<T>(number_value());
+		} else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>) {
+			if (type != STRING) return std::nullopt;
+			return T(string_value());
+		} else {
+			static_assert(always_false_v<T>, "try_get<T>() is not implemented for this type");
+		}
+	}
+
+	template<typename T>
+	T get_or(T fallback) const { return try_get<T>().value_or(std::move(fallback)); }
+
+	/// LOOKUP
+
+	// non-throwing counterparts of operator[], nullptr if this is not an
+	// object/array or the key/index does not exist. nothing is created
+	const smoljson* find(std::string_view key) const { return find_member(key, hash_key(key)); }
+	const smoljson* find(const key& k) const { return find_member(k.name, k.hash); }
+	const smoljson* find(size_t index) const {
+		if (type != ARRAY) return nullptr;
+		const array_t& arr = array_value();
+		return index < arr.size() ? &arr[index] : nullptr;
+	}
+
+	// mutable access, counts as a modification for the serialization cache
+	smoljson* find(std::string_view key) { invalidate_cache(); return const_cast<smoljson*>(std::as_const(*this).find(key)); }
+	smoljson* find(const key& k) { invalidate_cache(); return const_cast<smoljson*>(std::as_const(*this).find(k)); }
+	smoljson* find(size_t index) { invalidate_cache(); return const_cast<smoljson*>(std::as_const(*this).find(index)); }
+
+	bool contains(std::string_view key) const { return find(key) != nullptr; }
+	bool contains(const key& k) const { return find(k) != nullptr; }
+
 	/// HELPERS
 
 	bool is_array() const { return type == ARRAY; }
 	bool is_object() const { return type == OBJECT; }
 	bool is_null() const { return type == NULL_TYPE; }
-	size_t size() const { return is_array() ? std::get<array_t>(value).size() : 0; }
+	size_t size() const { return is_array() ? array_value().size() : 0; }
 
 	// throws if not an array!
-	array_t& as_vector() { return std::get<array_t>(value); } 
-	const array_t& as_vector() const { return std::get<array_t>(value); } 
+	array_t& as_vector() { invalidate_cache(); return std::get<array_t>(value); }
+	const array_t& as_vector() const { return array_value(); }
 
 	// throws if not an object!
-	object_t& as_map() { return std::get<object_t>(value); } 
-	const object_t& as_map() const { return std::get<object_t>(value); } 
+	object_t& as_map() { invalidate_cache(); return std::get<object_t>(value); }
+	const object_t& as_map() const { return object_value(); }
 
-	/// SERIALIZATION
-	
-	std::string serialize() const {
-		static const std::string null_str = "null";
-		static const std::string true_str = "true";
-		static const std::string false_str = "false";
-
-		auto num_to_string = [&]() {
-			const double& dbl = std::get<double>(value);
-			if (std::floor(dbl) == dbl) { // value is whole integer
-				return std::to_string(static_cast<long long>(dbl));
-			} else {
-				std::ostringstream oss;
-				oss << std::setprecision(15) << dbl;
-				std::string str = oss.str();
+	// the exact input text of this node while it is unmodified: containers
+	// parsed with keep_source, strings (quotes and escapes included) and
+	// numbers parsed with lazy_scalars. empty for everything else.
+	// useful for numbers that don't survive the trip through a double
+	std::string_view source_text() const {
+		return cached && cached->source ? cached->text : std::string_view();
+	}
 
-				str.erase(str.find_last_not_of('0') + 1, std::string::npos);
-				if (str.back() == '.') {
-					str.pop_back();
-				}
+	/// VIEWS
 
-				return str;
-			}
-		};
+	// read-only span over array elements
+	class array_view {
+		const smoljson* first = nullptr;
+		size_t count = 0;
 
-		auto escaped_string = [&]() {
-			const std::string& s = std::get<std::string>(value);
-			std::string result;
-			result.reserve(s.size()*2); // guess
-			result += '"';
-			for (unsigned char c : s) {
-				if (c < 0x20) {
-					result.append(control_escapes[c]);
-					continue;
-				}
+	public:
+		array_view() = default;
+		array_view(const smoljson* data, size_t size) : first(data), count(size) {}
 
-				if (c == '\\' || c == '"') {
-					result += '\\'; // add escaping backslash for \ and "
-				}
-				
-				result += c;
-			}
-			result += '"';
-			return result;
-		};
+		const smoljson* begin() const { return first; }
+		const smoljson* end() const { return first + count; }
+		const smoljson* data() const { return first; }
+		size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+		const smoljson& operator[](size_t index) const { return first[index]; }
+	};
 
-		switch (type) {
-			case NULL_TYPE: return null_str;
-			case STRING: return escaped_string();
-			case NUMBER: return num_to_string();
-			case BOOLEAN: return std::get<bool>(value) ? true_str : false_str;
-			case ARRAY: {
-				auto elements = map_container(
-					std::get<array_t>(value),
-					[](const smoljson& json) { return json.serialize(); }
-				);
-				return concat("[", join(elements, ","), "]");
-			}
-			case OBJECT: {
-					auto elements = map_container(
-					std::get<object_t>(value), 
-					[](const auto& entry) {
-						auto& [key, value] = entry;
-						return concat(smoljson(key).serialize(), ":", (*value).serialize());
-					}
-				);
-				return concat("{", join(elements, ","), "}");
-			}
-		}
+	struct entry {
+		std::string_view key;
+		const smoljson& value;
+	};
 
-		return ""; // unreachable, but compiler complains
-    }
+	// read-only range over object members as { key, value } pairs,
+	// for (auto [key, value] : j.items()) never touches the unique_ptrs
+	class object_view {
+		using base = typename object_t::const_iterator;
+		base first, last;
 
-	static smoljson parse(const std::string& json_literal) {
-		// this function is a minor clusterfuck but faster
-		// than my previous attempt using an actual
-		// tokenizer and parser.
-		size_t i = 0;
+	public:
+		class iterator {
+			base it;
 
-		auto parser_err = [&](const char* message) -> std::runtime_error {
-			size_t offset = i - 20 > json_literal.size() ? 0 : i - 20;
-			auto offending_json = json_literal.substr(offset, 40);
-			offending_json.erase(std::remove(offending_json.begin(), offending_json.end(), '\n'), offending_json.end());
-			offending_json.erase(std::remove(offending_json.begin(), offending_json.end(), '\r'), offending_json.end());
-			return std::runtime_error(concat(
-				message,
-				" at position: ",
-				std::to_string(i),
-				" see here:\n",
-				offending_json
-			));
-		};
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = entry;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = entry;
 
-		auto is_char = [&](char c) { return i < json_literal.size() && json_literal[i] == c; };
+			iterator() = default;
+			explicit iterator(base b) : it(b) {}
 
-		auto skip_whitespace = [&]() {
-			while (i < json_literal.size() && std::isspace(json_literal[i])) ++i;
+			entry operator*() const { return entry{ it->first, *it->second }; }
+			iterator& operator++() { ++it; return *this; }
+			iterator operator++(int) { iterator prev = *this; ++it; return prev; }
+			bool operator==(const iterator& other) const { return it == other.it; }
+			bool operator!=(const iterator& other) const { return it != other.it; }
 		};
 
-		auto parse_number = [&]() -> double {
-			size_t start = i;
-			auto consoom_numbers = [&] { while (i < json_literal.size() && std::isdigit(json_literal[i])) ++i; };
-			
-			if (is_char('-')) ++i;
-			consoom_numbers();
-			if (i < json_literal.size() && json_literal[i] == '.') {
-				++i;
-				consoom_numbers();
+		object_view() = default;
+		object_view(base b, base e) : first(b), last(e) {}
+
+		iterator begin() const { return iterator(first); }
+		iterator end() const { return iterator(last); }
+		size_t size() const { return static_cast<size_t>(last - first); }
+		bool empty() const { return first == last; }
+	};
+
+	// both are empty for any other type, so they never throw
+	array_view elements() const {
+		if (type != ARRAY) return {};
+		const array_t& arr = array_value();
+		return array_view(arr.data(), arr.size());
+	}
+
+	object_view items() const {
+		if (type != OBJECT) return {};
+		const object_t& map = object_value();
+		return object_view(map.begin(), map.end());
+	}
+
+	/// SERIALIZATION
+
+	std::string serialize() const {
+		std::string result;
+		string_sink sink{result};
+		write_json(sink);
+		return result;
+	}
+
+	// exact length of serialize() without building the string,
+	// including escape expansion and number widths
+	size_t serialized_size() const {
+		counting_sink sink;
+		write_json(sink);
+		return sink.count;
+	}
+
+	// writes the serialized json into dst without any allocation and
+	// returns the number of bytes written. does not null terminate.
+	// throws std::length_error if cap is smaller than serialized_size()
+	size_t serialize_to(char* dst, size_t cap) const {
+		buffer_sink sink{dst, dst + cap};
+		write_json(sink);
+		return sink.cur - dst;
+	}
+
+	// opt-in for documents that are re-serialized often but change rarely.
+	// containers keep their serialized text and only subtrees touched through
+	// a non-const accessor (operator[], as_vector(), as_map(), assignment)
+	// since the last serialization are formatted again. writes through a
+	// reference taken before a serialize are caught too: after any write,
+	// cached text is only reused once its subtree was checked for newer
+	// stamps, a walk without any formatting.
+	// costs one extra copy of the text per nesting level.
+	// disabling also drops the verbatim source slices kept by keep_source.
+	// serializing fills the cache, so with it enabled even const serialize()
+	// calls must not run concurrently on the same tree.
+	void enable_serialize_cache(bool enabled = true) {
+		caching = enabled;
+		if (!enabled) invalidate_cache();
+		if (is_lazy()) return; // still verbatim, its children inherit caching when written
+		if (type == ARRAY) {
+			for (smoljson& item : std::get<array_t>(value)) item.enable_serialize_cache(enabled);
+		} else if (type == OBJECT) {
+			for (auto& [key, val_ptr] : std::get<object_t>(value)) val_ptr->enable_serialize_cache(enabled);
+		}
+	}
+
+	// splits a large top-level array/object into one chunk per thread and
+	// formats the chunks concurrently. the chunks concatenate to exactly what
+	// serialize() returns, so they can be handed to writev() or similar as-is.
+	// containers with less than min_chunk items per thread are not split,
+	// neither are ones that still have their text (keep_source, caching,
+	// lazy containers that were never expanded).
+	std::vector<std::string> serialize_chunks(size_t threads = 0, size_t min_chunk = 256) const {
+		if (cached) return { serialize() }; // written as one piece, like write_json() does
+		if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+		size_t count = 0;
+		if (type == ARRAY) count = array_value().size();
+		if (type == OBJECT) count = object_value().size();
+
+		size_t chunks = std::min(threads, count / std::max<size_t>(min_chunk, 1));
+		if (chunks <= 1) return { serialize() };
+
+		// object entries are not random access, remember them up front
+		std::vector<const typename object_t::value_type*> entries;
+		if (type == OBJECT) {
+			entries.reserve(count);
+			for (const auto& entry : object_value()) entries.push_back(&entry);
+		}
+
+		auto format_chunk = [&](size_t chunk) {
+			std::string out;
+			string_sink sink{out};
+			if (chunk == 0) sink.put(type == ARRAY ? '[' : '{');
+
+			for (size_t i = count * chunk / chunks; i < count * (chunk + 1) / chunks; i++) {
+				if (i != 0) sink.put(',');
+				if (type == ARRAY) {
+					array_value()[i].write_json(sink);
+				} else {
+					write_escaped(sink, entries[i]->first);
+					sink.put(':');
+					entries[i]->second->write_json(sink);
+				}
 			}
-			
-			// scientific notation
-			if (is_char('e') || is_char('E')) {
-				++i;
-				if (is_char('-') || is_char('+')) ++i;
 
-				consoom_numbers();
+			if (chunk == chunks - 1) sink.put(type == ARRAY ? ']' : '}');
+			return out;
+		};
 
-				if (is_char('.')) {
-					++i;
-					consoom_numbers();
+		std::vector<std::future<std::string>> pending;
+		pending.reserve(chunks - 1);
+		for (size_t chunk = 1; chunk < chunks; chunk++) {
+			pending.push_back(std::async(std::launch::async, format_chunk, chunk));
+		}
+
+		std::vector<std::string> result;
+		result.reserve(chunks);
+		result.push_back(format_chunk(0)); // calling thread takes the first chunk
+		for (auto& chunk : pending) result.push_back(chunk.get());
+		return result;
+	}
+
+	// serialize_chunks() stitched into a single string with one allocation
+	std::string serialize_parallel(size_t threads = 0) const {
+		std::vector<std::string> chunks = serialize_chunks(threads);
+		if (chunks.size() == 1) return std::move(chunks[0]);
+
+		size_t total = 0;
+		for (const auto& chunk : chunks) total += chunk.size();
+
+		std::string result;
+		result.reserve(total);
+		for (const auto& chunk : chunks) result.append(chunk);
+		return result;
+	}
+
+	/// PARSING
+
+	class schema; // validates text with the parser below
+	class projection; // selects what parse() builds, see PROJECTION
+	class offset_index; // element offsets of huge arrays, see OFFSET INDEX
+
+	struct validate_options {
+		bool utf8 = false;       // also reject strings that are not valid UTF-8
+		size_t max_depth = 4096; // deepest nesting accepted, 4096 at most
+	};
+
+	struct parse_options {
+		static constexpr size_t no_limit = std::numeric_limits<size_t>::max();
+
+		// copy the input once and remember the source text of every container.
+		// serialize() then writes unmodified containers back byte for byte
+		// (including their original whitespace and number formatting) and only
+		// re-formats the ones changed through a non-const accessor since
+		bool keep_source = false;
+		// reject strings that are not valid utf-8, checked while the
+		// string runs are scanned anyway
+		bool validate_utf8 = false;
+		// strings and numbers are only checked and remember where they are in
+		// a shared copy of the input, they're decoded on first read. pays off
+		// for big documents of which only a few values are looked at, and
+		// keeps the exact number text around, see source_text()
+		bool lazy_scalars = false;
+		// containers nested deeper than this (the root is depth 0) are only
+		// bracket matched and expanded in place on first access, another
+		// eager_depth levels at a time. errors inside of them are reported
+		// (thrown) then. like lazy_scalars, first reads modify the node, so
+		// concurrent readers of an unexpanded document need a lock
+		size_t eager_depth = no_limit;
+	};
+
+	enum class error_code {
+		none,
+		unexpected_end,
+		unexpected_character,
+		expected_key,
+		expected_colon,
+		expected_array_end,
+		expected_object_end,
+		invalid_escape,
+		invalid_unicode,
+		invalid_number,
+		type_mismatch,
+		too_deep,
+		invalid_utf8,
+		trailing_characters
+	};
+
+	// cheap parse error, the human readable context is only built on demand
+	struct error {
+		error_code code = error_code::none;
+		size_t offset = 0;
+
+		explicit operator bool() const { return code != error_code::none; }
+
+		const char* message() const {
+			switch (code) {
+				case error_code::none: return "No error";
+				case error_code::unexpected_end: return "Unexpected end of input";
+				case error_code::unexpected_character: return "Unexpected character";
+				case error_code::expected_key: return "Expected string key";
+				case error_code::expected_colon: return "Expected ':'";
+				case error_code::expected_array_end: return "Expected ',' or ']'";
+				case error_code::expected_object_end: return "Expected ',' or '}'";
+				case error_code::invalid_escape: return "Unknown escape character";
+				case error_code::invalid_unicode: return "Invalid unicode escape";
+				case error_code::invalid_number: return "Invalid number";
+				case error_code::type_mismatch: return "Value does not match the field type";
+				case error_code::too_deep: return "Nesting too deep";
+				case error_code::invalid_utf8: return "Invalid UTF-8";
+				case error_code::trailing_characters: return "Unexpected data after the value";
+			}
+			return "Unknown error";
+		}
+
+		// message plus the surrounding input, input must be what was parsed
+		std::string describe(std::string_view input) const {
+			size_t from = offset < 20 ? 0 : offset - 20;
+			std::string offending_json(input.substr(std::min(from, input.size()), 40));
+			offending_json.erase(std::remove(offending_json.begin(), offending_json.end(), '\n'), offending_json.end());
+			offending_json.erase(std::remove(offending_json.begin(), offending_json.end(), '\r'), offending_json.end());
+			return concat(
+				message(),
+				" at position: ",
+				std::to_string(offset),
+				" see here:\n",
+				offending_json
+			);
+		}
+	};
+
+private:
+
+	// the one string grammar every reader goes through (parser, validator,
+	// offset_index, schema::validate_text, jsonpath streaming, formatter), so
+	// escape and utf-8 rules can't drift apart. i is just past the opening
+	// quote, the result is just past the closing one. on failure code is set
+	// and the result is the offending position. a string cut off by the end
+	// of json is unexpected_end at the start of the unfinished escape (or at
+	// the end), so chunked readers can resume from there after a refill
+	static size_t scan_string_body(std::string_view json, size_t i, bool utf8, bool& escaped, error_code& code) {
+		uint64_t high = utf8 ? swar_ones * 128 : 0;
+		while (true) {
+			// plain runs are skipped 8 bytes at a time
+			for (uint64_t x; i + 8 <= json.size(); i += 8) {
+				std::memcpy(&x, json.data() + i, 8);
+				if (swar_has_byte(x, '"') | swar_has_byte(x, '\\') | swar_has_less(x, 0x20) | (x & high)) break;
+			}
+			if (i >= json.size()) {
+				code = error_code::unexpected_end;
+				return i;
+			}
+
+			unsigned char c = static_cast<unsigned char>(json[i]);
+			if (c == '"') {
+				return i + 1;
+			} else if (c == '\\') {
+				char esc = i + 1 < json.size() ? json[i + 1] : '\0';
+				size_t length = esc == 'u' ? 6 : 2;
+				if (i + length > json.size()) {
+					code = error_code::unexpected_end;
+					return i;
+				}
+				if (esc == 'u' ? hex4(json.data() + i + 2) < 0 : esc == '\0' || !std::strchr("\"\\/bfnrt", esc)) {
+					code = esc == 'u' ? error_code::invalid_unicode : error_code::invalid_escape;
+					return i + (esc == 'u' ? 2 : 1);
 				}
+				escaped = true;
+				i += length;
+			} else if (c < 0x20) {
+				code = error_code::unexpected_character; // raw control characters have to be escaped
+				return i;
+			} else if (c >= 0x80 && utf8) {
+				size_t len = utf8_sequence(json.data() + i, json.size() - i);
+				if (len == 0) {
+					code = error_code::invalid_utf8;
+					return i;
+				}
+				i += len;
+			} else {
+				++i;
 			}
+		}
+	}
 
-			std::string num = json_literal.substr(start, i - start);
-			return std::stod(num); // let the exception bubble on invalid numbers
+	// the number grammar, shared the same way. i is at the '-' or first
+	// digit, the result is just past the number or the offending position
+	static size_t scan_number_text(std::string_view json, size_t i, error_code& code) {
+		size_t start = i;
+		auto digits = [&] {
+			size_t first = i;
+			while (i < json.size() && json[i] >= '0' && json[i] <= '9') ++i;
+			return i > first;
+		};
+		auto at = [&](char c) { return i < json.size() && json[i] == c; };
+		auto invalid = [&](size_t offset) {
+			code = error_code::invalid_number;
+			return offset;
 		};
 
-		auto parse_string = [&]() -> std::string {
-			++i; // skip the opening quote
-			std::string result;
-			result.reserve(100); // based on statistically accurate heuristic (i guessed)
-			while (i < json_literal.size()) {
-				char c = json_literal[i++];
-				if (c == '"') {
+		if (at('-')) ++i;
+		size_t first = i;
+		if (!digits()) return invalid(i);
+		if (json[first] == '0' && i - first > 1) return invalid(first); // no leading zeros
+		if (at('.')) {
+			++i;
+			if (!digits()) return invalid(i);
+		}
+
+		// scientific notation
+		bool exponent = at('e') || at('E');
+		if (exponent) {
+			++i;
+			if (at('-') || at('+')) ++i;
+			if (!digits()) return invalid(i);
+		}
+
+		// only an exponent or a few hundred digits can leave the range of a
+		// double, those few are converted right away so every reader rejects
+		// the same numbers (like 1e999)
+		double ignored = 0;
+		if ((exponent || i - start > 300) && !to_number(json.substr(start, i - start), ignored, false)) return invalid(start);
+		return i;
+	}
+
+	// decodes the escapes of a string body scan_string_body() accepted
+	static void unescape(std::string_view body, std::string& out) {
+		out.reserve(out.size() + body.size());
+		size_t k = 0;
+		while (true) {
+			size_t next = body.find('\\', k);
+			out.append(body.data() + k, (next == std::string_view::npos ? body.size() : next) - k);
+			if (next == std::string_view::npos) return;
+			char esc = body[next + 1];
+			k = next + 2;
+			switch (esc) {
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u': {
+					int32_t cp = hex4(body.data() + k);
+					k += 4;
+					// utf-16 surrogate pairs, a half without its partner becomes U+FFFD
+					if (cp >= 0xD800 && cp <= 0xDBFF) {
+						int32_t low = k + 6 <= body.size() && body[k] == '\\' && body[k + 1] == 'u' ? hex4(body.data() + k + 2) : -1;
+						if (low >= 0xDC00 && low <= 0xDFFF) {
+							cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+							k += 6;
+						} else {
+							cp = 0xFFFD;
+						}
+					} else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+						cp = 0xFFFD;
+					}
+					append_utf8(out, static_cast<uint32_t>(cp));
 					break;
-				} else if (c == '\\') {
-					if (i >= json_literal.size()) throw parser_err("Invalid escape sequence");
-					char esc = json_literal[i++];
-					switch (esc) {
-						case '"': result += '"'; break;
-						case '\\': result += '\\'; break;
-						case '/': result += '/'; break;
-						case 'b': result += '\b'; break;
-						case 'f': result += '\f'; break;
-						case 'n': result += '\n'; break;
-						case 'r': result += '\r'; break;
-						case 't': result += '\t'; break;
-						case 'u': {
-							if (i + 4 > json_literal.size()) throw parser_err("Invalid unicode escape");
-							std::string hex = json_literal.substr(i, 4);
-							i += 4;
-							char16_t unicode_char = static_cast<char16_t>(std::stoi(hex, nullptr, 16));
-							// note: basic implementation; UTF-16 to UTF-8 conversion not fully handled
-							if (unicode_char < 0x80) {
-								result += static_cast<char>(unicode_char);
-							} else {
-								result += '?';
-							}
-							break;
+				}
+				default: out += esc; // " \ /
+			}
+		}
+	}
+
+	// serialized text of a container, either formatted by us (owned) or a
+	// slice of the parsed input that source keeps alive (keep_source,
+	// lazy_scalars, eager_depth)
+	struct cached_text {
+		std::shared_ptr<const std::string> source;
+		std::string owned;
+		std::string_view text;
+		uint64_t generation = 0; // owned text, edit_count when it was formatted
+		bool escaped = false;   // lazy string that needs its escapes decoded
+		parse_options options;  // unparsed container, how to expand it
+	};
+
+	// this is a minor clusterfuck but faster than my previous attempt
+	// using an actual tokenizer and parser. every function returns false
+	// on error after recording it, nothing here throws
+	class parser {
+		friend class schema; // streams text through the same grammar
+		friend class offset_index; // skips elements to record where they are
+
+		std::string_view json;
+		size_t i = 0;
+		const parse_options& options;
+		error& err;
+		std::shared_ptr<const std::string> source; // keep_source copy
+		size_t depth = 0; // containers entered, for eager_depth
+		const projection* project = nullptr;
+
+		bool fail(error_code code) {
+			err.code = code;
+			err.offset = i;
+			return false;
+		}
+
+		bool is_char(char c) const { return i < json.size() && json[i] == c; }
+
+		static bool is_whitespace(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+		static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+		void skip_whitespace() {
+			while (i < json.size() && is_whitespace(json[i])) ++i;
+		}
+
+		// verbatim slices are taken from the shared copy so they outlive the input
+		void keep_text(smoljson& container, size_t start) {
+			if (!options.keep_source) return;
+			container.cached = std::make_unique<cached_text>();
+			container.cached->source = source;
+			container.cached->text = json.substr(start, i - start);
+		}
+
+		// checks the number grammar and moves past it
+		bool scan_number() {
+			error_code code = error_code::none;
+			i = scan_number_text(json, i, code);
+			return code == error_code::none || fail(code);
+		}
+
+		bool parse_number(double& out) {
+			size_t start = i;
+			if (!scan_number()) return false;
+			if (!to_number(json.substr(start, i - start), out, false)) return fail(error_code::invalid_number);
+			return true;
+		}
+
+		bool parse_string(std::string& result) {
+			size_t start = i;
+			bool escaped = false;
+			if (!scan_string(escaped)) return false;
+			std::string_view body = json.substr(start + 1, i - start - 2);
+			if (escaped) unescape(body, result);
+			else result.append(body);
+			return true;
+		}
+
+		// checks a string like parse_string() without building it
+		bool scan_string(bool& escaped) {
+			error_code code = error_code::none;
+			i = scan_string_body(json, i + 1, options.validate_utf8, escaped, code);
+			return code == error_code::none || fail(code);
+		}
+
+		// finds the end of the container at i by counting brackets outside
+		// of strings and nothing else, 8 bytes at a time. the contents are
+		// only checked when the node is expanded
+		bool skip_brackets() {
+			size_t nesting = 0;
+			while (true) {
+				for (uint64_t x; i + 8 <= json.size(); i += 8) {
+					std::memcpy(&x, json.data() + i, 8);
+					uint64_t folded = x | (swar_ones * 0x20); // [ and ] become { and }
+					if (swar_has_byte(x, '"') | swar_has_byte(folded, '{') | swar_has_byte(folded, '}')) break;
+				}
+				if (i >= json.size()) return fail(error_code::unexpected_end);
+
+				char c = json[i++];
+				if (c == '[' || c == '{') {
+					++nesting;
+				} else if (c == ']' || c == '}') {
+					if (--nesting == 0) return true;
+				} else if (c == '"') {
+					while (true) {
+						for (uint64_t x; i + 8 <= json.size(); i += 8) {
+							std::memcpy(&x, json.data() + i, 8);
+							if (swar_has_byte(x, '"') | swar_has_byte(x, '\\')) break;
 						}
-						default:
-							throw parser_err("Unknown escape character");
+						while (i < json.size() && json[i] != '"' && json[i] != '\\') ++i;
+						if (i >= json.size()) return fail(error_code::unexpected_end);
+						if (json[i++] == '"') break;
+						++i; // whatever is escaped
 					}
-				} else {
-					result += c;
 				}
 			}
-			return result;
-		};
+		}
+
+		// the node only remembers its slice, see smoljson::decode()
+		bool parse_lazy(smoljson& out, json_type type) {
+			size_t start = i;
+			bool escaped = false;
+			bool found = type == STRING ? scan_string(escaped) : type == NUMBER ? scan_number() : skip_brackets();
+			if (!found) return false;
+			out.type = type;
+			out.value = std::monostate{};
+			out.cached = std::make_unique<cached_text>();
+			out.cached->source = source;
+			out.cached->text = json.substr(start, i - start);
+			out.cached->escaped = escaped;
+			if (type == ARRAY || type == OBJECT) {
+				out.cached->options = options;
+				out.cached->options.eager_depth = std::max<size_t>(options.eager_depth, 1); // expanding builds at least a level
+			}
+			return true;
+		}
 
-		std::function<smoljson()> parse_value = [&]() -> smoljson {
+		bool parse_value(smoljson& out) {
 			skip_whitespace();
-			if (i >= json_literal.size()) throw parser_err("Unexpected end of input");
+			if (i >= json.size()) return fail(error_code::unexpected_end);
 
-			char c = json_literal[i];
-			if (c == '"') return smoljson(parse_string());
-			if (std::isdigit(c) || c == '-') return smoljson(parse_number());
+			char c = json[i];
+			if (options.lazy_scalars && (c == '"' || is_digit(c) || c == '-')) {
+				return parse_lazy(out, c == '"' ? STRING : NUMBER);
+			}
+			if (c == '"') {
+				out = smoljson(std::string());
+				return parse_string(std::get<std::string>(out.value));
+			}
+			if (is_digit(c) || c == '-') {
+				double number = 0;
+				if (!parse_number(number)) return false;
+				out = number;
+				return true;
+			}
 
-			if (c == 't' && json_literal.substr(i, 4) == "true") {
-				i += 4; return smoljson(true);
+			if (c == 't' && json.substr(i, 4) == "true") {
+				i += 4; out = true; return true;
 			}
-			if (c == 'f' && json_literal.substr(i, 5) == "false") {
-				i += 5; return smoljson(false);
+			if (c == 'f' && json.substr(i, 5) == "false") {
+				i += 5; out = false; return true;
 			}
-			if (c == 'n' && json_literal.substr(i, 4) == "null") {
-				i += 4; return smoljson(nullptr);
+			if (c == 'n' && json.substr(i, 4) == "null") {
+				i += 4; out = nullptr; return true;
+			}
+			if ((c == '[' || c == '{') && depth >= options.eager_depth) {
+				return parse_lazy(out, c == '[' ? ARRAY : OBJECT);
 			}
 			if (c == '[') {
+				size_t start = i;
 				++i;
 				skip_whitespace();
-				smoljson instance = array({});
-				array_t& arr = instance.as_vector();
+				out = array({});
+				array_t& arr = std::get<array_t>(out.value);
 				if (is_char(']')) {
 					++i;
-					return instance;
+					keep_text(out, start);
+					return true;
 				}
+				++depth;
 				while (true) {
-					arr.push_back(std::move(parse_value()));
+					arr.emplace_back();
+					if (!parse_value(arr.back())) return false;
 					skip_whitespace();
-					if (is_char(',')) { ++i;skip_whitespace(); continue; }
+					if (is_char(',')) { ++i; skip_whitespace(); continue; }
 					if (is_char(']')) { ++i; break; }
-					throw parser_err("Expected ',' or ']'");
+					return fail(i < json.size() ? error_code::expected_array_end : error_code::unexpected_end);
 				}
-				return instance;
+				--depth;
+				keep_text(out, start);
+				return true;
 			}
 			if (c == '{') {
+				size_t start = i;
 				++i; skip_whitespace();
-				smoljson obj = object({});
+				out = object({});
+				object_t& map = std::get<object_t>(out.value);
 				if (is_char('}')) {
 					++i;
-					return obj;
+					keep_text(out, start);
+					return true;
 				}
+				++depth;
 				while (true) {
-					if (i < json_literal.size() && json_literal[i] != '"') throw parser_err("Expected string key");
-					std::string key = parse_string();
+					if (i >= json.size()) return fail(error_code::unexpected_end);
+					if (json[i] != '"') return fail(error_code::expected_key);
+					std::string key;
+					if (!parse_string(key)) return false;
 					skip_whitespace();
-					if (i < json_literal.size() && json_literal[i] != ':') throw parser_err("Expected ':'");
+					if (i >= json.size()) return fail(error_code::unexpected_end);
+					if (json[i] != ':') return fail(error_code::expected_colon);
 					++i; skip_whitespace();
-					obj[key] = parse_value();
+
+					// duplicate keys: the last one wins
+					uint64_t hash = hash_key(key);
+					auto it = map.find(key, hash);
+					if (it == map.end()) it = map.insert_new(std::move(key), hash, std::make_unique<smoljson>());
+					if (!parse_value(*it->second)) return false;
+
 					skip_whitespace();
 					if (is_char(',')) { ++i; skip_whitespace(); continue; }
 					if (is_char('}')) { ++i; break; }
-					throw parser_err("Expected ',' or '}'");
+					return fail(i < json.size() ? error_code::expected_object_end : error_code::unexpected_end);
+				}
+				--depth;
+				keep_text(out, start);
+				return true;
+			}
+
+			return fail(error_code::unexpected_character);
+		}
+
+		// parse_value() for the parts selected at step `at` of the projection,
+		// skipped values are only checked. kept is false when nothing was built
+		bool parse_projected(smoljson& out, size_t at, bool& kept) {
+			kept = true;
+			if (project->whole(at)) return parse_value(out);
+
+			skip_whitespace();
+			if (i >= json.size()) return fail(error_code::unexpected_end);
+			char c = json[i];
+			if (c != '[' && c != '{') {
+				if (project->keep_member) return parse_value(out);
+				kept = false; // a pointer that continues below a scalar
+				return skip_value();
+			}
+
+			++i; skip_whitespace();
+			++depth;
+			if (c == '[') {
+				out = array({});
+				array_t& arr = std::get<array_t>(out.value);
+				for (size_t position = 0; !is_char(']'); ++position) {
+					if (position != 0) {
+						if (!is_char(',')) return fail(i < json.size() ? error_code::expected_array_end : error_code::unexpected_end);
+						++i;
+					}
+					size_t next = project->element(at, position);
+					if (next == projection::none) {
+						if (!skip_value()) return false;
+					} else {
+						smoljson item;
+						bool item_kept = false;
+						if (!parse_projected(item, next, item_kept)) return false;
+						if (item_kept) {
+							arr.resize(position); // skipped elements in between become null
+							arr.push_back(std::move(item));
+						}
+					}
+					skip_whitespace();
+				}
+			} else {
+				out = object({});
+				object_t& map = std::get<object_t>(out.value);
+				std::string scratch;
+				for (bool first = true; !is_char('}'); first = false) {
+					if (!first) {
+						if (!is_char(',')) return fail(i < json.size() ? error_code::expected_object_end : error_code::unexpected_end);
+						++i; skip_whitespace();
+					}
+					if (i >= json.size()) return fail(error_code::unexpected_end);
+					if (json[i] != '"') return fail(error_code::expected_key);
+					std::string_view key;
+					if (!read_key(key, scratch)) return false;
+					skip_whitespace();
+					if (i >= json.size()) return fail(error_code::unexpected_end);
+					if (json[i] != ':') return fail(error_code::expected_colon);
+					++i;
+
+					size_t next = project->member(at, key);
+					if (next == projection::none) {
+						if (!skip_value()) return false;
+					} else {
+						smoljson item;
+						bool item_kept = false;
+						std::string name(key); // key may point into scratch
+						if (!parse_projected(item, next, item_kept)) return false;
+						if (item_kept) {
+							uint64_t hash = hash_key(name);
+							auto it = map.find(name, hash);
+							if (it == map.end()) map.insert_new(std::move(name), hash, std::make_unique<smoljson>(std::move(item)));
+							else *it->second = std::move(item); // the last duplicate wins
+						}
+					}
+					skip_whitespace();
+				}
+			}
+			--depth;
+			++i; // closing bracket
+			return true;
+		}
+
+		/// TYPED READING
+
+		bool skip_string() {
+			bool escaped = false;
+			return scan_string(escaped);
+		}
+
+		// same grammar as parse_value() but nothing is built
+		bool skip_value() {
+			skip_whitespace();
+			if (i >= json.size()) return fail(error_code::unexpected_end);
+
+			char c = json[i];
+			if (c == '"') return skip_string();
+			if (is_digit(c) || c == '-') return scan_number();
+			if (c == 't' && json.substr(i, 4) == "true") { i += 4; return true; }
+			if (c == 'f' && json.substr(i, 5) == "false") { i += 5; return true; }
+			if (c == 'n' && json.substr(i, 4) == "null") { i += 4; return true; }
+			if (c == '[' || c == '{') {
+				char close = c == '[' ? ']' : '}';
+				++i; skip_whitespace();
+				if (is_char(close)) { ++i; return true; }
+				while (true) {
+					if (c == '{') {
+						if (i >= json.size()) return fail(error_code::unexpected_end);
+						if (json[i] != '"') return fail(error_code::expected_key);
+						if (!skip_string()) return false;
+						skip_whitespace();
+						if (i >= json.size()) return fail(error_code::unexpected_end);
+						if (json[i] != ':') return fail(error_code::expected_colon);
+						++i;
+					}
+					if (!skip_value()) return false;
+					skip_whitespace();
+					if (is_char(',')) { ++i; skip_whitespace(); continue; }
+					if (is_char(close)) { ++i; return true; }
+					if (i >= json.size()) return fail(error_code::unexpected_end);
+					return fail(c == '[' ? error_code::expected_array_end : error_code::expected_object_end);
+				}
+			}
+			return fail(error_code::unexpected_character);
+		}
+
+		// keys without escapes are viewed in place, the rest is decoded into scratch
+		bool read_key(std::string_view& key, std::string& scratch) {
+			size_t start = i;
+			bool escaped = false;
+			if (!scan_string(escaped)) return false;
+			key = json.substr(start + 1, i - start - 2);
+			if (!escaped) return true;
+			scratch.clear();
+			unescape(key, scratch);
+			key = scratch;
+			return true;
+		}
+
+		template<typename T>
+		// whole numbers that fit T, also spelled 2.0 or 1e3. fractions and
+		// values out of range are a type_mismatch at the number, nothing is
+		// truncated or wrapped
+		bool read_integer(T& out) {
+			size_t start = i;
+			if (!scan_number()) return false;
+			std::string_view text = json.substr(start, i - start);
+			auto mismatch = [&] {
+				i = start;
+				return fail(error_code::type_mismatch);
+			};
+			if (text.find_first_of(".eE") == std::string_view::npos) {
+				auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+				if (ec != std::errc() || end != text.data() + text.size()) return mismatch();
+				return true;
+			}
+			double number = 0;
+			if (!to_number(text, number, false)) return fail(error_code::invalid_number);
+			// max() + 1 is a power of two, exact as a double where max() may not be
+			if (std::trunc(number) != number || number < static_cast<double>(std::numeric_limits<T>::lowest())
+				|| number >= static_cast<double>(std::numeric_limits<T>::max()) + 1) return mismatch();
+			out = static_cast<T>(number);
+			return true;
+		}
+
+		template<typename T, size_t... I>
+		bool read_field(T& out, size_t index, std::index_sequence<I...>) {
+			constexpr auto& fields = field_table<T>::fields;
+			bool ok = false;
+			static_cast<void>(((index == I && (ok = read(out.*std::get<I>(fields).member), true)) || ...));
+			return ok;
+		}
+
+		template<typename T>
+		bool read_fields(T& out) {
+			using table = field_table<T>;
+			++i; skip_whitespace();
+			if (is_char('}')) { ++i; return true; }
+			std::string scratch;
+			size_t expected = 0; // keys usually come in declaration order, try the next one before hashing
+			while (true) {
+				if (i >= json.size()) return fail(error_code::unexpected_end);
+				if (json[i] != '"') return fail(error_code::expected_key);
+				std::string_view key;
+				if (!read_key(key, scratch)) return false;
+				skip_whitespace();
+				if (i >= json.size()) return fail(error_code::unexpected_end);
+				if (json[i] != ':') return fail(error_code::expected_colon);
+				++i;
+
+				size_t index = expected < table::count && table::names[expected] == key ? expected : table::find(key);
+				if (index != table::count) expected = index + 1;
+				if (index == table::count) {
+					if (!skip_value()) return false; // unknown keys never become nodes
+				} else if (!read_field(out, index, std::make_index_sequence<table::count>{})) {
+					return false;
 				}
-				return obj;
+
+				skip_whitespace();
+				if (is_char(',')) { ++i; skip_whitespace(); continue; }
+				if (is_char('}')) { ++i; return true; }
+				return fail(i < json.size() ? error_code::expected_object_end : error_code::unexpected_end);
+			}
+		}
+
+	public:
+		// input is a slice of shared, which keeps it alive for the new nodes
+		parser(std::string_view input, const parse_options& opts, error& error_out, std::shared_ptr<const std::string> shared)
+			: json(input), options(opts), err(error_out), source(std::move(shared)) {}
+
+		parser(std::string_view input, const parse_options& opts, error& error_out) : json(input), options(opts), err(error_out) {
+			if (options.keep_source || options.lazy_scalars || options.eager_depth != parse_options::no_limit) {
+				source = std::make_shared<const std::string>(input);
+				json = *source;
 			}
+		}
+
+		// the whole input has to be exactly one value, like validate()
+		bool parse_document(smoljson& out) { return parse_value(out) && at_end(); }
+
+		bool parse_document(smoljson& out, const projection& keep) {
+			project = &keep;
+			bool kept = false;
+			return parse_projected(out, 0, kept) && at_end();
+		}
+
+		bool at_end() {
+			skip_whitespace();
+			return i >= json.size() || fail(error_code::trailing_characters);
+		}
 
-			throw parser_err("Unexpected character");
+		struct text_range {
+			smoljson* node;
+			size_t begin;
+			size_t end;
 		};
 
-		return parse_value();
-	}
+		// for reparse(): the containers of tree whose text strictly contains
+		// [from, to), from the root down. tree has to be what the input
+		// parses to, the walk stops early where it doesn't match
+		bool enclosing(smoljson& tree, size_t from, size_t to, std::vector<text_range>& chain) {
+			// the input parsed before, counting brackets is enough to skip containers
+			auto skip_parsed = [&] { return is_char('[') || is_char('{') ? skip_brackets() : skip_value(); };
 
-};
+			// the root ends at the last non-whitespace byte, no need to skip it
+			skip_whitespace();
+			if (i >= json.size()) return fail(error_code::unexpected_end);
+			size_t end = json.size();
+			while (end > i && is_whitespace(json[end - 1])) --end;
+			chain.push_back(text_range{&tree, i, end});
+
+			std::string scratch;
+			while (true) {
+				text_range outer = chain.back();
+				char open = json[outer.begin];
+				if ((open != '[' && open != '{') || !(outer.begin < from && to < outer.end)) return true;
+
+				// find the child value around the edit. a key that shows up again
+				// later in the object wins on parse, so that one isn't descended into
+				const smoljson* inner = nullptr;
+				text_range found{nullptr, 0, 0};
+				std::string found_key;
+				char close = open == '[' ? ']' : '}';
+				i = outer.begin + 1;
+				skip_whitespace();
+				for (size_t position = 0; !is_char(close); ++position) {
+					if (position != 0) { ++i; skip_whitespace(); } // the comma
+					std::string_view key;
+					if (open == '{') {
+						if (!read_key(key, scratch)) return false;
+						skip_whitespace();
+						++i; // the colon
+						skip_whitespace();
+					}
+					size_t child = i;
+					if (!skip_parsed()) return false;
+					skip_whitespace();
+
+					if (!found.node && child < from && to < i && (json[child] == '[' || json[child] == '{')) {
+						inner = open == '[' ? std::as_const(*outer.node).find(position) : std::as_const(*outer.node).find(key);
+						found = text_range{outer.node, child, i};
+						found_key = key;
+						if (open == '[') break;
+					} else if (found.node && open == '{' && key == found_key) {
+						inner = nullptr;
+					}
+				}
+				json_type expected = found.node && json[found.begin] == '[' ? ARRAY : OBJECT;
+				if (!inner || inner->type != expected) return true;
+				chain.push_back(text_range{const_cast<smoljson*>(inner), found.begin, found.end});
+			}
+		}
+
+		// parses an unparsed container in place. it was only bracket matched,
+		// so this is where errors inside of it are reported
+		static void expand(const smoljson& node) {
+			const cached_text& text = *node.cached;
+			error err;
+			parser p(text.text, text.options, err, text.source);
+			smoljson result;
+			if (!p.parse_value(result)) SMOLJSON_THROW(std::runtime_error(err.describe(text.text)));
+			node.value = std::move(result.value);
+		}
+
+		// lazy strings were checked when they were scanned, this can't fail
+		static std::string decode_string(std::string_view quoted) {
+			std::string result;
+			unescape(quoted.substr(1, quoted.size() - 2), result);
+			return result;
+		}
+
+		// reads straight into a typed value. null leaves the value as it
+		// is (resets optionals and unique_ptrs), any other json type that
+		// does not fit is a type_mismatch
+		template<typename T>
+		bool read(T& out) {
+			skip_whitespace();
+			if (i >= json.size()) return fail(error_code::unexpected_end);
+
+			char c = json[i];
+			if constexpr (std::is_same_v<T, smoljson>) {
+				return parse_value(out);
+			} else {
+				if (c == 'n' && json.substr(i, 4) == "null") {
+					i += 4;
+					if constexpr (is_optional<T>::value || is_unique_ptr<T>::value) out.reset();
+					return true;
+				}
+
+				if constexpr (is_optional<T>::value) {
+					return read(out.emplace());
+				} else if constexpr (is_unique_ptr<T>::value) {
+					// the indirection lets a struct hold a member of its own type
+					if (!out) out = std::make_unique<typename T::element_type>();
+					return read(*out);
+				} else if constexpr (std::is_same_v<T, bool>) {
+					if (c == 't' && json.substr(i, 4) == "true") { i += 4; out = true; return true; }
+					if (c == 'f' && json.substr(i, 5) == "false") { i += 5; out = false; return true; }
+					return fail(error_code::type_mismatch);
+				} else if constexpr (std::is_arithmetic_v<T>) {
+					if (!is_digit(c) && c != '-') return fail(error_code::type_mismatch);
+					if constexpr (std::is_integral_v<T>) {
+						return read_integer(out);
+					} else {
+						double number = 0;
+						if (!parse_number(number)) return false;
+						out = static_cast<T>(number);
+						return true;
+					}
+				} else if constexpr (std::is_same_v<T, std::string>) {
+					if (c != '"') return fail(error_code::type_mismatch);
+					out.clear();
+					return parse_string(out);
+				} else if constexpr (container_traits<T>::sequence) {
+					if (c != '[') return fail(error_code::type_mismatch);
+					++i; skip_whitespace();
+					size_t count = 0;
+					if constexpr (!container_traits<T>::fixed_size) out.clear();
+					if (is_char(']')) { ++i; return true; }
+					while (true) {
+						if constexpr (container_traits<T>::fixed_size) {
+							if (count < out.size() ? !read(out[count]) : !skip_value()) return false;
+						} else if constexpr (std::is_same_v<typename T::value_type, bool>) {
+							bool item = false; // std::vector<bool> has no real references
+							if (!read(item)) return false;
+							out.push_back(item);
+						} else {
+							if (!read(out.emplace_back())) return false;
+						}
+						++count;
+						skip_whitespace();
+						if (is_char(',')) { ++i; continue; }
+						if (is_char(']')) { ++i; return true; }
+						return fail(i < json.size() ? error_code::expected_array_end : error_code::unexpected_end);
+					}
+				} else if constexpr (container_traits<T>::mapping) {
+					if (c != '{') return fail(error_code::type_mismatch);
+					++i; skip_whitespace();
+					out.clear();
+					if (is_char('}')) { ++i; return true; }
+					while (true) {
+						if (i >= json.size()) return fail(error_code::unexpected_end);
+						if (json[i] != '"') return fail(error_code::expected_key);
+						std::string key;
+						if (!parse_string(key)) return false;
+						skip_whitespace();
+						if (i >= json.size()) return fail(error_code::unexpected_end);
+						if (json[i] != ':') return fail(error_code::expected_colon);
+						++i;
+						if (!read(out[std::move(key)])) return false;
+						skip_whitespace();
+						if (is_char(',')) { ++i; skip_whitespace(); continue; }
+						if (is_char('}')) { ++i; return true; }
+						return fail(i < json.size() ? error_code::expected_object_end : error_code::unexpected_end);
+					}
+				} else if constexpr (has_fields<T>::value) {
+					if (c != '{') return fail(error_code::type_mismatch);
+					return read_fields(out);
+				} else {
+					static_assert(always_false_v<T>, "type has no SMOLJSON_FIELDS and is not supported by parse_as()");
+				}
+			}
+		}
+	};
+
+	// well-formedness check without building anything. iterative, the
+	// nesting lives in a fixed bit stack so nothing is allocated at all.
+	// strings and numbers use the parser's scanners, so both accept
+	// exactly the same documents
+	class validator {
+		static constexpr size_t stack_words = 64;
+
+		std::string_view json;
+		size_t i = 0;
+		const validate_options& options;
+		error& err;
+		uint64_t stack[stack_words]; // bit set: object, clear: array
+		size_t depth = 0;
+
+		bool fail(error_code code) {
+			err.code = code;
+			err.offset = i;
+			return false;
+		}
+
+		bool is_char(char c) const { return i < json.size() && json[i] == c; }
+		static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+		void skip_whitespace() {
+			while (i < json.size() && (json[i] == ' ' || json[i] == '\n' || json[i] == '\r' || json[i] == '\t')) ++i;
+		}
+
+		bool push(bool object) {
+			if (depth >= options.max_depth || depth >= stack_words * 64) return fail(error_code::too_deep);
+			uint64_t bit = uint64_t(1) << (depth % 64);
+			if (object) stack[depth / 64] |= bit;
+			else stack[depth / 64] &= ~bit;
+			++depth;
+			++i;
+			return true;
+		}
+
+		bool in_object() const { return (stack[(depth - 1) / 64] >> ((depth - 1) % 64)) & 1; }
+
+		bool scan_string() {
+			bool escaped = false;
+			error_code code = error_code::none;
+			i = scan_string_body(json, i + 1, options.utf8, escaped, code);
+			return code == error_code::none || fail(code);
+		}
+
+		bool scan_number() {
+			error_code code = error_code::none;
+			i = scan_number_text(json, i, code);
+			return code == error_code::none || fail(code);
+		}
+
+		bool scan_key() {
+			skip_whitespace();
+			if (i >= json.size()) return fail(error_code::unexpected_end);
+			if (json[i] != '"') return fail(error_code::expected_key);
+			if (!scan_string()) return false;
+			skip_whitespace();
+			if (i >= json.size()) return fail(error_code::unexpected_end);
+			if (json[i] != ':') return fail(error_code::expected_colon);
+			++i;
+			return true;
+		}
+
+	public:
+		validator(std::string_view input, const validate_options& opts, error& error_out) : json(input), options(opts), err(error_out) {}
+
+		bool run() {
+			while (true) {
+				// a value
+				skip_whitespace();
+				if (i >= json.size()) return fail(error_code::unexpected_end);
+				char c = json[i];
+				if (c == '{' || c == '[') {
+					if (!push(c == '{')) return false;
+					skip_whitespace();
+					if (!is_char(c == '{' ? '}' : ']')) {
+						if (c == '{' && !scan_key()) return false;
+						continue;
+					}
+					++i;
+					--depth;
+				} else if (c == '"') {
+					if (!scan_string()) return false;
+				} else if (is_digit(c) || c == '-') {
+					if (!scan_number()) return false;
+				} else if (c == 't' && json.substr(i, 4) == "true") {
+					i += 4;
+				} else if (c == 'f' && json.substr(i, 5) == "false") {
+					i += 5;
+				} else if (c == 'n' && json.substr(i, 4) == "null") {
+					i += 4;
+				} else {
+					return fail(error_code::unexpected_character);
+				}
+
+				// after a value: close containers until the next one starts
+				while (true) {
+					skip_whitespace();
+					if (depth == 0) return i == json.size() || fail(error_code::trailing_characters);
+					if (i >= json.size()) return fail(error_code::unexpected_end);
+					bool object = in_object();
+					if (json[i] == ',') {
+						++i;
+						if (object && !scan_key()) return false;
+						break;
+					}
+					if (json[i] != (object ? '}' : ']')) return fail(object ? error_code::expected_object_end : error_code::expected_array_end);
+					++i;
+					--depth;
+				}
+			}
+		}
+	};
+
+	// compile-time perfect hash over a struct's field names, the seed is
+	// searched until every name gets its own slot
+	template<typename T>
+	struct field_table {
+		static constexpr auto fields = smoljson_fields(static_cast<const T*>(nullptr));
+		static constexpr size_t count = std::tuple_size_v<std::decay_t<decltype(fields)>>;
+		static_assert(count < 255, "too many fields for SMOLJSON_FIELDS");
+
+		static constexpr std::array<std::string_view, count> names = std::apply([](const auto&... f) {
+			return std::array<std::string_view, count>{ f.name... };
+		}, fields);
+
+		static constexpr size_t slot_bits = [] {
+			size_t bits = 2;
+			while ((size_t(1) << bits) < count * 4) ++bits;
+			return bits;
+		}();
+
+		struct perfect_hash {
+			uint64_t seed = 0;
+			std::array<uint8_t, size_t(1) << slot_bits> slots{}; // field index + 1, 0 is empty
+			bool found = false;
+		};
+
+		static constexpr size_t slot_of(std::string_view name, uint64_t seed) {
+			return static_cast<size_t>(hash_key(name, seed) >> (64 - slot_bits));
+		}
+
+		static constexpr perfect_hash build() {
+			perfect_hash table;
+			for (uint64_t seed = 0; seed < 4096; ++seed) {
+				table.seed = seed;
+				table.slots = {};
+				size_t placed = 0;
+				for (; placed < count; ++placed) {
+					size_t slot = slot_of(names[placed], seed);
+					if (table.slots[slot] != 0) break;
+					table.slots[slot] = static_cast<uint8_t>(placed + 1);
+				}
+				if (placed == count) {
+					table.found = true;
+					return table;
+				}
+			}
+			return table;
+		}
+
+		static constexpr perfect_hash hash = build();
+		static_assert(hash.found, "no perfect hash for these field names, are there duplicates?");
+
+		// index of the field or count if there is none
+		static size_t find(std::string_view key) {
+			size_t index = hash.slots[slot_of(key, hash.seed)];
+			return index != 0 && names[index - 1] == key ? index - 1 : count;
+		}
+	};
+
+	template<typename T, typename = void> struct has_fields : std::false_type {};
+	template<typename T> struct has_fields<T, std::void_t<decltype(smoljson_fields(static_cast<const T*>(nullptr)))>> : std::true_type {};
+
+public:
+
+	/// TYPED PARSING
+
+	// one entry of a SMOLJSON_FIELDS table. quoted is the key as it is
+	// written, "\"name\":", identifiers never need escaping
+	template<typename Owner, typename T>
+	struct field {
+		std::string_view name;
+		std::string_view quoted;
+		T Owner::* member;
+	};
+
+	template<typename Owner, typename T>
+	static constexpr field<Owner, T> make_field(std::string_view name, std::string_view quoted, T Owner::* member) {
+		return field<Owner, T>{ name, quoted, member };
+	}
+
+	// parses text straight into a struct described by SMOLJSON_FIELDS (or a
+	// vector/map/optional of them) without building a tree. keys are looked
+	// up in a compile-time perfect hash and unknown keys are skipped.
+	// fields missing from the input keep their default value
+	template<typename T>
+	static T parse_as(std::string_view json_literal) {
+		T result{};
+		error err;
+		if (!parse_into(json_literal, result, err)) SMOLJSON_THROW(std::runtime_error(err.describe(json_literal)));
+		return result;
+	}
+
+	template<typename T>
+	static bool parse_into(std::string_view json_literal, T& out, error& err) {
+		err = error{};
+		parse_options options;
+		parser p(json_literal, options, err);
+		return p.read(out) && p.at_end();
+	}
+
+	static smoljson parse(std::string_view json_literal) {
+		return parse(json_literal, parse_options{});
+	}
+
+	static smoljson parse(std::string_view json_literal, const parse_options& options) {
+		error err;
+		smoljson result = parse(json_literal, options, err);
+		if (err) SMOLJSON_THROW(std::runtime_error(err.describe(json_literal)));
+		return result;
+	}
+
+	// non-throwing variants, on failure err is set and null is returned
+	static smoljson parse(std::string_view json_literal, error& err) {
+		return parse(json_literal, parse_options{}, err);
+	}
+
+	static smoljson parse(std::string_view json_literal, const parse_options& options, error& err) {
+		err = error{};
+		smoljson result;
+		if (!parser(json_literal, options, err).parse_document(result)) return smoljson();
+		return result;
+	}
+
+	// builds only what keep selects, see projection. options apply to the
+	// subtrees that are kept whole
+	static smoljson parse(std::string_view json_literal, const projection& keep) {
+		error err;
+		smoljson result = parse(json_literal, parse_options{}, keep, err);
+		if (err) SMOLJSON_THROW(std::runtime_error(err.describe(json_literal)));
+		return result;
+	}
+
+	static smoljson parse(std::string_view json_literal, const parse_options& options, const projection& keep, error& err) {
+		err = error{};
+		smoljson result;
+		if (!parser(json_literal, options, err).parse_document(result, keep)) return smoljson();
+		return result;
+	}
+
+	/// INCREMENTAL REPARSE
+
+	// a change to a text: removed bytes at offset replaced by inserted
+	struct text_edit {
+		size_t offset = 0;
+		size_t removed = 0;
+		std::string_view inserted;
+
+		void apply(std::string& text) const { text.replace(offset, removed, inserted); }
+	};
+
+	// brings doc, parsed from old_text, up to date with edit. only the
+	// smallest container whose text strictly contains the edited bytes is
+	// parsed again (a bigger one if the new text doesn't fit in there, like
+	// an added bracket) and moved into that node, everything outside of it
+	// keeps its address. returns that node, or nullptr with err set when the
+	// edited text is not valid json, doc then still matches old_text.
+	// throws std::out_of_range if the edit is not inside old_text
+	static smoljson* reparse(smoljson& doc, std::string_view old_text, const text_edit& edit, const parse_options& options, error& err) {
+		err = error{};
+		if (edit.offset > old_text.size() || edit.removed > old_text.size() - edit.offset) {
+			SMOLJSON_THROW(std::out_of_range("Edit is outside of the text"));
+		}
+
+		parse_options plain;
+		error ignored;
+		std::vector<parser::text_range> chain;
+		parser(old_text, plain, ignored).enclosing(doc, edit.offset, edit.offset + edit.removed, chain);
+
+		// chain[0] is the whole document, handled below
+		for (size_t level = chain.size(); level-- > 1;) {
+			const parser::text_range& range = chain[level];
+			std::string text;
+			text.reserve(range.end - range.begin + edit.inserted.size());
+			text += old_text.substr(range.begin, edit.offset - range.begin);
+			text += edit.inserted;
+			text += old_text.substr(edit.offset + edit.removed, range.end - edit.offset - edit.removed);
+
+			smoljson result;
+			error local;
+			if (!parser(text, options, local).parse_document(result)) continue;
+			for (size_t outer = 0; outer < level; ++outer) chain[outer].node->invalidate_cache();
+			*range.node = std::move(result);
+			return range.node;
+		}
+
+		std::string text(old_text);
+		edit.apply(text);
+		smoljson result = parse(text, options, err);
+		if (err) return nullptr;
+		doc = std::move(result);
+		return &doc;
+	}
+
+	static smoljson* reparse(smoljson& doc, std::string_view old_text, const text_edit& edit, error& err) {
+		return reparse(doc, old_text, edit, parse_options{}, err);
+	}
+
+	/// VALIDATION
+
+	// checks that the input is exactly one well-formed json value without
+	// creating a single node or string. plain string contents are scanned
+	// 8 bytes at a time
+	static bool validate(std::string_view json_literal) {
+		error err;
+		return validate(json_literal, validate_options{}, err);
+	}
+
+	static bool validate(std::string_view json_literal, error& err) {
+		return validate(json_literal, validate_options{}, err);
+	}
+
+	static bool validate(std::string_view json_literal, const validate_options& options, error& err) {
+		err = error{};
+		return validator(json_literal, options, err).run();
+	}
+
+	/// MINIFY
+
+private:
+
+	// text to text in one pass, only tracks whether it is inside a string
+	// (with the shared string scanner). state survives between feed() calls
+	// so input can arrive in chunks.
+	// indent 0 strips all insignificant whitespace, anything else
+	// re-indents. the input is assumed to be well-formed, run validate()
+	// first when it might not be
+	class formatter {
+		size_t indent;
+		size_t depth = 0;
+		bool in_string = false;
+		bool escaped = false;
+		bool pending_open = false; // just opened a container, newline only if it is not empty
+
+		// how much of in, from i, still belongs to the current string. the
+		// byte after a backslash that ended the last chunk is taken blindly,
+		// malformed strings are passed through as they are
+		size_t string_end(std::string_view in, size_t i) {
+			if (escaped && i < in.size()) {
+				escaped = false;
+				++i;
+			}
+			while (i < in.size()) {
+				bool unused = false;
+				error_code code = error_code::none;
+				size_t end = scan_string_body(in, i, false, unused, code);
+				if (code == error_code::none) {
+					in_string = false;
+					return end;
+				}
+				if (code == error_code::unexpected_end) {
+					escaped = end + 1 == in.size();
+					return in.size();
+				}
+				i = std::max(end, i + 1);
+			}
+			return i;
+		}
+
+		void newline(std::string& out) const {
+			out.push_back('\n');
+			out.append(depth * indent, ' ');
+		}
+
+		void flush_pending(std::string& out) {
+			if (!pending_open) return;
+			pending_open = false;
+			newline(out);
+		}
+
+	public:
+		explicit formatter(size_t indent_width) : indent(indent_width) {}
+
+		// minified output is never longer than the input, so it is written
+		// through a raw pointer into space reserved up front
+		void feed_minified(std::string_view in, std::string& out) {
+			const char* p = in.data();
+			size_t n = in.size();
+			size_t i = 0;
+			size_t base = out.size();
+			out.resize(base + n);
+			char* w = &out[base];
+			while (i < n) {
+				size_t start = i;
+				if (in_string) {
+					i = string_end(in, i);
+					std::memcpy(w, p + start, i - start);
+					w += i - start;
+					continue;
+				}
+				// copy up to the next whitespace or quote
+				for (uint64_t x; i + 8 <= n; i += 8) {
+					std::memcpy(&x, p + i, 8);
+					if (swar_has_less(x, 0x21) | swar_has_byte(x, '"')) break;
+				}
+				while (i < n && static_cast<unsigned char>(p[i]) > 0x20 && p[i] != '"') ++i;
+				std::memcpy(w, p + start, i - start);
+				w += i - start;
+				if (i == n) break;
+
+				char c = p[i++];
+				if (c == '"') {
+					*w++ = c;
+					in_string = true;
+				}
+				// anything else is whitespace and dropped
+			}
+			out.resize(static_cast<size_t>(w - out.data()));
+		}
+
+		void feed(std::string_view in, std::string& out) {
+			if (indent == 0) return feed_minified(in, out);
+			const char* p = in.data();
+			size_t n = in.size();
+			size_t i = 0;
+			while (i < n) {
+				if (in_string) {
+					size_t start = i;
+					i = string_end(in, i);
+					out.append(p + start, i - start);
+					continue;
+				}
+
+				char c = p[i++];
+				switch (c) {
+					case ' ': case '\n': case '\r': case '\t': break;
+					case '{': case '[':
+						flush_pending(out);
+						out.push_back(c);
+						++depth;
+						pending_open = true;
+						break;
+					case '}': case ']':
+						if (depth > 0) --depth;
+						if (pending_open) pending_open = false;
+						else newline(out);
+						out.push_back(c);
+						break;
+					case ',':
+						out.push_back(',');
+						newline(out);
+						break;
+					case ':':
+						out.append(": ", 2);
+						break;
+					case '"':
+						flush_pending(out);
+						out.push_back('"');
+						in_string = true;
+						break;
+					default:
+						flush_pending(out);
+						out.push_back(c);
+				}
+			}
+		}
+	};
+
+	static void format_stream(std::istream& in, std::ostream& out, size_t indent, size_t chunk_size) {
+		formatter f(indent);
+		std::string buffer(chunk_size, '\0');
+		std::string result;
+		while (in) {
+			in.read(&buffer[0], static_cast<std::streamsize>(chunk_size));
+			std::streamsize got = in.gcount();
+			if (got <= 0) break;
+			result.clear();
+			f.feed(std::string_view(buffer.data(), static_cast<size_t>(got)), result);
+			out.write(result.data(), static_cast<std::streamsize>(result.size()));
+		}
+	}
+
+public:
+
+	// strips insignificant whitespace straight from the text. keys keep
+	// their order and numbers their spelling, nothing is parsed
+	static std::string minify(std::string_view json_literal) {
+		std::string result;
+		result.reserve(json_literal.size());
+		formatter(0).feed(json_literal, result);
+		return result;
+	}
+
+	// same single pass, but indents by indent spaces per level
+	static std::string reformat(std::string_view json_literal, size_t indent = 4) {
+		std::string result;
+		result.reserve(json_literal.size() + json_literal.size() / 2);
+		formatter(indent).feed(json_literal, result);
+		return result;
+	}
+
+	// chunked variants for documents that should not be held in memory
+	static void minify(std::istream& in, std::ostream& out, size_t chunk_size = 1 << 16) {
+		format_stream(in, out, 0, chunk_size);
+	}
+
+	static void reformat(std::istream& in, std::ostream& out, size_t indent = 4, size_t chunk_size = 1 << 16) {
+		format_stream(in, out, indent, chunk_size);
+	}
+
+	/// OFFSET INDEX
+
+	// byte ranges of the elements of a top-level array, built in one pass
+	// and saved next to the file (see sidecar_path()), so later runs can
+	// parse element k or a range of them without scanning from the start:
+	//   auto index = smoljson::offset_index::build(text);
+	//   std::ofstream(smoljson::offset_index::sidecar_path("dump.json"), std::ios::binary) << index;
+	//   smoljson user = index.parse(file, 1000000); // reads just that element
+	// with nested set the elements of arrays and the member values of
+	// objects one level below are recorded as well
+	class offset_index {
+		static constexpr char magic[8] = { 's', 'm', 'o', 'l', 'i', 'd', 'x', '2' };
+
+		struct span {
+			uint64_t begin;
+			uint64_t end;
+		};
+
+		uint64_t source_size = 0;
+		uint64_t stamp = 0; // caller's version of the source, e.g. its mtime
+		std::vector<span> elements;
+		std::vector<uint64_t> first_child; // nested: children of k are [first_child[k], first_child[k + 1])
+		std::vector<span> children;
+
+		const span& element_span(size_t k) const {
+			if (k >= elements.size()) SMOLJSON_THROW(std::out_of_range("element index out of bounds"));
+			return elements[k];
+		}
+
+		const span& child_span(size_t k, size_t j) const {
+			if (first_child.empty()) SMOLJSON_THROW(std::logic_error("index was built without nested offsets"));
+			if (j >= child_count(k)) SMOLJSON_THROW(std::out_of_range("child index out of bounds"));
+			return children[first_child[k] + j];
+		}
+
+		// records the children of the value at p.i while skipping it
+		bool skip_nested(parser& p) {
+			p.skip_whitespace();
+			char open = p.i < p.json.size() ? p.json[p.i] : '\0';
+			if (open != '[' && open != '{') return p.skip_value();
+
+			char close = open == '[' ? ']' : '}';
+			++p.i; p.skip_whitespace();
+			if (p.is_char(close)) { ++p.i; return true; }
+			while (true) {
+				if (open == '{') {
+					if (p.i >= p.json.size()) return p.fail(error_code::unexpected_end);
+					if (p.json[p.i] != '"') return p.fail(error_code::expected_key);
+					if (!p.skip_string()) return false;
+					p.skip_whitespace();
+					if (p.i >= p.json.size()) return p.fail(error_code::unexpected_end);
+					if (p.json[p.i] != ':') return p.fail(error_code::expected_colon);
+					++p.i; p.skip_whitespace();
+				}
+				uint64_t begin = p.i;
+				if (!p.skip_value()) return false;
+				children.push_back(span{begin, p.i});
+				p.skip_whitespace();
+				if (p.is_char(',')) { ++p.i; p.skip_whitespace(); continue; }
+				if (p.is_char(close)) { ++p.i; return true; }
+				if (p.i >= p.json.size()) return p.fail(error_code::unexpected_end);
+				return p.fail(open == '[' ? error_code::expected_array_end : error_code::expected_object_end);
+			}
+		}
+
+	public:
+		// non-throwing, on failure err is set and out is left empty
+		static bool build(std::string_view json_literal, offset_index& out, error& err, bool nested = false) {
+			err = error{};
+			out = offset_index{};
+			parse_options options;
+			parser p(json_literal, options, err);
+
+			p.skip_whitespace();
+			if (!p.is_char('[')) return p.fail(p.i < json_literal.size() ? error_code::unexpected_character : error_code::unexpected_end);
+			++p.i; p.skip_whitespace();
+			bool ok = true;
+			if (p.is_char(']')) {
+				++p.i;
+			} else {
+				while (true) {
+					p.skip_whitespace();
+					if (nested) out.first_child.push_back(out.children.size());
+					uint64_t begin = p.i;
+					if (!(nested ? out.skip_nested(p) : p.skip_value())) { ok = false; break; }
+					out.elements.push_back(span{begin, p.i});
+					p.skip_whitespace();
+					if (p.is_char(',')) { ++p.i; continue; }
+					if (p.is_char(']')) { ++p.i; break; }
+					ok = p.fail(p.i < json_literal.size() ? error_code::expected_array_end : error_code::unexpected_end);
+					break;
+				}
+			}
+			if (ok) {
+				p.skip_whitespace();
+				if (p.i < json_literal.size()) ok = p.fail(error_code::trailing_characters);
+			}
+			if (!ok) {
+				out = offset_index{};
+				return false;
+			}
+			if (nested) out.first_child.push_back(out.children.size());
+			out.source_size = json_literal.size();
+			return true;
+		}
+
+		// throws std::runtime_error if json_literal is not an array
+		static offset_index build(std::string_view json_literal, bool nested = false) {
+			offset_index result;
+			error err;
+			if (!build(json_literal, result, err, nested)) SMOLJSON_THROW(std::runtime_error(err.describe(json_literal)));
+			return result;
+		}
+
+		static std::string sidecar_path(std::string_view json_path) { return concat(json_path, ".idx"); }
+
+		size_t size() const { return elements.size(); }
+		bool nested() const { return !first_child.empty(); }
+		size_t child_count(size_t k) const { return nested() && k < elements.size() ? first_child[k + 1] - first_child[k] : 0; }
+
+		// size of the document the offsets belong to, a cheap staleness check
+		uint64_t source_size_bytes() const { return source_size; }
+
+		// anything that identifies the version of the source (its mtime, a
+		// hash), saved with the offsets. size alone misses same-size edits
+		uint64_t source_stamp() const { return stamp; }
+		void set_source_stamp(uint64_t value) { stamp = value; }
+
+		// the text of element k, json_literal being the whole (e.g. mmapped) document
+		std::string_view element(std::string_view json_literal, size_t k) const {
+			const span& e = element_span(k);
+			return json_literal.substr(e.begin, e.end - e.begin);
+		}
+
+		std::string_view child(std::string_view json_literal, size_t k, size_t j) const {
+			const span& c = child_span(k, j);
+			return json_literal.substr(c.begin, c.end - c.begin);
+		}
+
+		smoljson parse(std::string_view json_literal, size_t k) const { return smoljson::parse(element(json_literal, k)); }
+		smoljson parse(std::string_view json_literal, size_t k, size_t j) const { return smoljson::parse(child(json_literal, k, j)); }
+
+		// elements [first, first + count), clamped to the end
+		std::vector<smoljson> parse_range(std::string_view json_literal, size_t first, size_t count) const {
+			std::vector<smoljson> result;
+			for (size_t k = first; k < std::min(elements.size(), first + count); ++k) result.push_back(parse(json_literal, k));
+			return result;
+		}
+
+		// stream variants read only the bytes of the requested elements
+		smoljson parse(std::istream& file, size_t k) const {
+			std::vector<smoljson> result = parse_range(file, k, 1);
+			if (result.empty()) SMOLJSON_THROW(std::out_of_range("element index out of bounds"));
+			return std::move(result.front());
+		}
+
+		std::vector<smoljson> parse_range(std::istream& file, size_t first, size_t count) const {
+			std::vector<smoljson> result;
+			size_t last = std::min(elements.size(), first + count);
+			if (first >= last) return result;
+
+			uint64_t from = elements[first].begin;
+			std::string text(elements[last - 1].end - from, '\0');
+			file.clear();
+			file.seekg(static_cast<std::streamoff>(from));
+			file.read(text.data(), static_cast<std::streamsize>(text.size()));
+			if (static_cast<size_t>(file.gcount()) != text.size()) SMOLJSON_THROW(std::runtime_error("Could not read the indexed range"));
+
+			result.reserve(last - first);
+			for (size_t k = first; k < last; ++k) {
+				result.push_back(smoljson::parse(std::string_view(text).substr(elements[k].begin - from, elements[k].end - elements[k].begin)));
+			}
+			return result;
+		}
+
+		// raw native-endian dump: magic, source size, counts, stamp, then the offsets
+		friend std::ostream& operator<<(std::ostream& out, const offset_index& index) {
+			auto put = [&](const void* data, size_t bytes) { out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes)); };
+			uint64_t counts[4] = { index.source_size, index.elements.size(), index.children.size(), index.stamp };
+			uint8_t has_children = index.nested();
+			put(magic, sizeof(magic));
+			put(counts, sizeof(counts));
+			put(&has_children, 1);
+			put(index.elements.data(), index.elements.size() * sizeof(span));
+			put(index.first_child.data(), index.first_child.size() * sizeof(uint64_t));
+			put(index.children.data(), index.children.size() * sizeof(span));
+			return out;
+		}
+
+		// sets failbit on anything that is not an index written by operator<<,
+		// including counts and offsets that do not fit the recorded file size
+		friend std::istream& operator>>(std::istream& in, offset_index& index) {
+			auto get = [&](void* data, size_t bytes) {
+				in.read(static_cast<char*>(data), static_cast<std::streamsize>(bytes));
+				return static_cast<size_t>(in.gcount()) == bytes;
+			};
+			// grows with the data that actually arrives, a corrupt count
+			// runs out of stream long before it runs out of memory
+			auto get_all = [&](auto& out, uint64_t count) {
+				constexpr uint64_t chunk = 1 << 16;
+				for (uint64_t done = 0; done < count;) {
+					size_t n = static_cast<size_t>(std::min(chunk, count - done));
+					out.resize(out.size() + n);
+					if (!get(out.data() + done, n * sizeof(out[0]))) return false;
+					done += n;
+				}
+				return true;
+			};
+			index = offset_index{};
+			char header[sizeof(magic)];
+			uint64_t counts[4];
+			uint8_t has_children = 0;
+			bool ok = get(header, sizeof(header)) && std::memcmp(header, magic, sizeof(magic)) == 0
+				&& get(counts, sizeof(counts)) && get(&has_children, 1) && has_children <= 1
+				// every element and child takes at least one byte of the source
+				&& counts[1] <= counts[0] && counts[2] <= counts[0] && (has_children || counts[2] == 0)
+				&& get_all(index.elements, counts[1])
+				&& get_all(index.first_child, has_children ? counts[1] + 1 : 0)
+				&& get_all(index.children, counts[2]);
+			index.source_size = ok ? counts[0] : 0;
+			index.stamp = ok ? counts[3] : 0;
+
+			// spans in order and inside the file, children inside their element
+			uint64_t previous = 0;
+			for (size_t k = 0; ok && k < index.elements.size(); ++k) {
+				const span& e = index.elements[k];
+				ok = previous <= e.begin && e.begin <= e.end && e.end <= index.source_size;
+				previous = e.end;
+				if (!ok || !has_children) continue;
+
+				uint64_t first = index.first_child[k], last = index.first_child[k + 1];
+				ok = first <= last && last <= index.children.size(); // with the check below: monotonic from 0 to children.size()
+				for (uint64_t c = first, inner = e.begin; ok && c < last; ++c) {
+					const span& child = index.children[c];
+					ok = inner <= child.begin && child.begin <= child.end && child.end <= e.end;
+					inner = child.end;
+				}
+			}
+			if (ok && has_children) ok = index.first_child.front() == 0 && index.first_child.back() == index.children.size();
+
+			if (!ok) {
+				index = offset_index{};
+				in.setstate(std::ios::failbit);
+			}
+			return in;
+		}
+	};
+
+	/// JSON POINTER
+
+	// RFC 6901 json pointer ("/user/address/city"), compiled once. every
+	// segment keeps its unescaped key, the key's hash and the array index it
+	// stands for, so resolving does no parsing or hashing at all
+	class pointer {
+		friend class smoljson;
+
+		static constexpr size_t no_index = static_cast<size_t>(-1);
+
+		struct segment {
+			std::string key;
+			uint64_t hash;
+			size_t index; // no_index if the segment is not a valid array index
+		};
+
+		std::vector<segment> segments;
+
+		pointer() = default;
+
+		void append(std::string key) {
+			uint64_t hash = hash_key(key);
+			size_t index = parse_index(key);
+			segments.push_back(segment{std::move(key), hash, index});
+		}
+
+		static size_t parse_index(std::string_view key) {
+			if (key.empty() || key.size() > 19 || (key[0] == '0' && key.size() > 1)) return no_index;
+			size_t index = 0;
+			for (char c : key) {
+				if (c < '0' || c > '9') return no_index;
+				index = index * 10 + (c - '0');
+			}
+			return index;
+		}
+
+		static const smoljson* step(const smoljson* node, const segment& seg) {
+			if (node->type == OBJECT) {
+				const object_t& map = node->object_value();
+				auto it = map.find(seg.key, seg.hash);
+				return it == map.end() ? nullptr : it->second.get();
+			}
+			if (node->type == ARRAY) {
+				const array_t& arr = node->array_value();
+				return seg.index < arr.size() ? &arr[seg.index] : nullptr;
+			}
+			return nullptr;
+		}
+
+	public:
+		// throws std::invalid_argument if path is not a valid json pointer
+		explicit pointer(std::string_view path) {
+			if (path.empty()) return; // whole document
+			if (path[0] != '/') SMOLJSON_THROW(std::invalid_argument("Json pointer must start with '/'"));
+
+			size_t i = 1;
+			while (true) {
+				std::string key;
+				for (; i < path.size() && path[i] != '/'; i++) {
+					if (path[i] != '~') {
+						key += path[i];
+						continue;
+					}
+					if (i + 1 >= path.size() || (path[i + 1] != '0' && path[i + 1] != '1')) {
+						SMOLJSON_THROW(std::invalid_argument("Invalid '~' escape in json pointer"));
+					}
+					key += path[++i] == '0' ? '~' : '/';
+				}
+				append(std::move(key));
+				if (i++ >= path.size()) break;
+			}
+		}
+
+		size_t size() const { return segments.size(); }
+
+		// nullptr if any segment is missing
+		const smoljson* resolve(const smoljson& doc) const {
+			const smoljson* node = &doc;
+			for (const segment& seg : segments) {
+				node = step(node, seg);
+				if (!node) return nullptr;
+			}
+			return node;
+		}
+	};
+
+	// resolves all pointers in one pass. pointers are visited in sorted order
+	// so a shared prefix (like /user/address in /user/address/city and
+	// /user/address/zip) is walked only once. result[i] belongs to pointers[i]
+	// and is nullptr if that path does not exist
+	static std::vector<const smoljson*> get_many(const smoljson& doc, const std::vector<pointer>& pointers) {
+		std::vector<size_t> order(pointers.size());
+		for (size_t i = 0; i < order.size(); i++) order[i] = i;
+		std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			const auto& sa = pointers[a].segments;
+			const auto& sb = pointers[b].segments;
+			return std::lexicographical_compare(sa.begin(), sa.end(), sb.begin(), sb.end(),
+				[](const pointer::segment& x, const pointer::segment& y) { return x.key < y.key; });
+		});
+
+		std::vector<const smoljson*> result(pointers.size(), nullptr);
+		std::vector<const smoljson*> path{ &doc }; // path[d] = node after d segments of previous
+		const pointer* previous = nullptr;
+
+		for (size_t i : order) {
+			const auto& segs = pointers[i].segments;
+
+			size_t shared = 0;
+			if (previous) {
+				const auto& prev = previous->segments;
+				while (shared < segs.size() && shared < prev.size() && shared + 1 < path.size()
+					&& segs[shared].key == prev[shared].key) ++shared;
+			}
+			path.resize(shared + 1);
+
+			for (size_t d = shared; d < segs.size() && path.back(); d++) {
+				path.push_back(pointer::step(path.back(), segs[d]));
+			}
+
+			previous = &pointers[i];
+			if (path.size() == segs.size() + 1) result[i] = path.back();
+		}
+		return result;
+	}
+
+	/// PROJECTION
+
+	// the parts of a document parse() should build, everything else is
+	// skipped by the scanner and never allocated. either a set of json
+	// pointers, where a * segment matches every member or element:
+	//   smoljson::projection keep({ "/*/_id", "/*/email", "/*/age" });
+	// or a predicate on member keys, checked at every level:
+	//   smoljson::projection keep([](std::string_view key) { return key != "friends"; });
+	// containers on a selected path are always kept (possibly empty),
+	// scalars only if a pointer ends at them. array elements that are
+	// skipped before a kept one become null, so indices stay valid
+	class projection {
+		friend class smoljson;
+
+		static constexpr size_t none = static_cast<size_t>(-1);
+
+		// one node of the trie of all pointers, steps[0] is the root
+		struct step {
+			bool whole = false; // a pointer ends here, keep everything below
+			size_t any = none;  // * segment
+			std::vector<std::pair<pointer::segment, size_t>> next;
+		};
+
+		std::vector<step> steps;
+		std::function<bool(std::string_view)> keep_member;
+
+		void add(const pointer& path) {
+			size_t at = 0;
+			for (const pointer::segment& seg : path.segments) {
+				if (steps[at].whole) return; // an ancestor is kept whole anyway
+				size_t found = seg.key == "*" ? steps[at].any : none;
+				for (const auto& [s, index] : steps[at].next) {
+					if (found == none && seg.key != "*" && s.key == seg.key) found = index;
+				}
+				if (found == none) {
+					found = steps.size();
+					if (seg.key == "*") steps[at].any = found;
+					else steps[at].next.emplace_back(seg, found);
+					steps.emplace_back();
+				}
+				at = found;
+			}
+			steps[at].whole = true;
+		}
+
+		bool whole(size_t at) const { return !keep_member && steps[at].whole; }
+
+		// step for a member or element of the container at step at, none to skip it
+		size_t member(size_t at, std::string_view key) const {
+			if (keep_member) return keep_member(key) ? at : none;
+			for (const auto& [seg, index] : steps[at].next) {
+				if (seg.key == key) return index;
+			}
+			return steps[at].any;
+		}
+
+		size_t element(size_t at, size_t position) const {
+			if (keep_member) return at;
+			for (const auto& [seg, index] : steps[at].next) {
+				if (seg.index == position) return index;
+			}
+			return steps[at].any;
+		}
+
+	public:
+		// throws std::invalid_argument like pointer
+		projection(std::initializer_list<std::string_view> pointers) : steps(1) {
+			for (std::string_view path : pointers) add(pointer(path));
+		}
+
+		explicit projection(const std::vector<pointer>& pointers) : steps(1) {
+			for (const pointer& path : pointers) add(path);
+		}
+
+		explicit projection(std::function<bool(std::string_view key)> predicate) : steps(1), keep_member(std::move(predicate)) {}
+	};
+
+	/// JSONPATH
+
+	// JSONPath query compiled into a flat list of steps. supported subset:
+	//   $                  root
+	//   .name ['name']     child
+	//   .* [*]             all array elements / object values
+	//   ..name ..* ..[0]   recursive descent
+	//   [2] [-1]           array index, negative counts from the end
+	//   [1:10:2] [::-1]    array slice with python semantics
+	//   [?(@.a.b == 1)]    filter on scalars with == != < <= > >=
+	//   [?(@.a)]           filter on existence
+	// select() walks the tree step by step and only collects pointers to the
+	// matching nodes, nothing is copied. throws std::invalid_argument when the
+	// expression can not be compiled
+	class path {
+		enum op_code { CHILD, WILDCARD, INDEX, SLICE, FILTER, DESCEND };
+		enum compare_op { EXISTS, EQ, NE, LT, LE, GT, GE };
+
+		// right hand side of a filter, smoljson itself is still incomplete here
+		struct scalar {
+			json_type type = NULL_TYPE;
+			std::string str;
+			double number = 0;
+			bool boolean = false;
+		};
+
+		struct step {
+			op_code op;
+			std::string key;   // CHILD
+			uint64_t hash = 0; // CHILD
+			long long start = 0, end = 0, stride = 1; // INDEX uses start
+			bool has_start = false, has_end = false;  // SLICE
+			pointer operand;   // FILTER, relative to @
+			compare_op cmp = EXISTS;
+			scalar literal;    // FILTER
+
+			explicit step(op_code code) : op(code) {}
+		};
+
+		std::vector<step> steps;
+
+		// compiler
+
+		std::string_view expr;
+		size_t i = 0;
+
+		[[noreturn]] void fail(const char* message) const {
+			SMOLJSON_THROW(std::invalid_argument(concat(message, " at position ", std::to_string(i), " in JSONPath: ", expr)));
+		}
+
+		void skip_ws() { while (i < expr.size() && std::isspace(static_cast<unsigned char>(expr[i]))) ++i; }
+		bool at(char c) const { return i < expr.size() && expr[i] == c; }
+
+		void expect(char c) {
+			skip_ws();
+			if (!at(c)) fail(c == ']' ? "Expected ']'" : c == ')' ? "Expected ')'" : "Unexpected character");
+			++i;
+		}
+
+		std::string parse_name() {
+			size_t start = i;
+			while (i < expr.size() && expr[i] != '.' && expr[i] != '[' && !std::isspace(static_cast<unsigned char>(expr[i]))
+				&& expr[i] != ')' && expr[i] != '=' && expr[i] != '!' && expr[i] != '<' && expr[i] != '>') ++i;
+			if (start == i) fail("Expected member name");
+			return std::string(expr.substr(start, i - start));
+		}
+
+		std::string parse_quoted() {
+			char quote = expr[i++];
+			std::string result;
+			while (i < expr.size() && expr[i] != quote) {
+				if (expr[i] == '\\' && i + 1 < expr.size()) ++i;
+				result += expr[i++];
+			}
+			if (!at(quote)) fail("Unterminated string");
+			++i;
+			return result;
+		}
+
+		bool parse_int(long long& out) {
+			skip_ws();
+			size_t start = i;
+			if (at('-')) ++i;
+			while (i < expr.size() && std::isdigit(static_cast<unsigned char>(expr[i]))) ++i;
+			if (start == i || (i == start + 1 && expr[start] == '-')) {
+				i = start;
+				return false;
+			}
+			auto [end, ec] = std::from_chars(expr.data() + start, expr.data() + i, out);
+			if (ec != std::errc() || end != expr.data() + i) fail("Invalid index");
+			return true;
+		}
+
+		void add_child(std::string key) {
+			step s(CHILD);
+			s.hash = hash_key(key);
+			s.key = std::move(key);
+			steps.push_back(std::move(s));
+		}
+
+		// @.a['b'][0] inside a filter
+		pointer parse_operand() {
+			skip_ws();
+			if (!at('@')) fail("Expected '@'");
+			++i;
+			pointer operand;
+			while (true) {
+				if (at('.')) {
+					++i;
+					operand.append(parse_name());
+				} else if (at('[')) {
+					++i;
+					skip_ws();
+					if (at('\'') || at('"')) {
+						operand.append(parse_quoted());
+					} else {
+						long long index;
+						if (!parse_int(index) || index < 0) fail("Expected name or index");
+						operand.append(std::to_string(index));
+					}
+					expect(']');
+				} else {
+					return operand;
+				}
+			}
+		}
+
+		scalar parse_literal() {
+			skip_ws();
+			scalar lit;
+			if (at('\'') || at('"')) {
+				lit.type = STRING;
+				lit.str = parse_quoted();
+				return lit;
+			}
+			if (expr.substr(i, 4) == "true" || expr.substr(i, 5) == "false") {
+				lit.type = BOOLEAN;
+				lit.boolean = expr[i] == 't';
+				i += lit.boolean ? 4 : 5;
+				return lit;
+			}
+			if (expr.substr(i, 4) == "null") {
+				i += 4;
+				return lit;
+			}
+
+			size_t start = i;
+			while (i < expr.size() && (std::isdigit(static_cast<unsigned char>(expr[i])) || std::strchr("+-.eE", expr[i]))) ++i;
+			if (start == i) fail("Expected literal");
+			std::string num(expr.substr(start, i - start));
+			char* end = nullptr;
+			lit.type = NUMBER;
+			lit.number = std::strtod(num.c_str(), &end);
+			if (end != num.c_str() + num.size()) fail("Invalid number");
+			return lit;
+		}
+
+		void parse_filter() {
+			step s(FILTER);
+			expect('(');
+			s.operand = parse_operand();
+			skip_ws();
+
+			static constexpr std::pair<std::string_view, compare_op> ops[] = {
+				{"==", EQ}, {"!=", NE}, {"<=", LE}, {">=", GE}, {"<", LT}, {">", GT}
+			};
+			for (const auto& [text, op] : ops) {
+				if (expr.substr(i, text.size()) == text) {
+					i += text.size();
+					s.cmp = op;
+					s.literal = parse_literal();
+					break;
+				}
+			}
+
+			expect(')');
+			steps.push_back(std::move(s));
+		}
+
+		void parse_bracket() {
+			++i; // [
+			skip_ws();
+			if (at('\'') || at('"')) {
+				add_child(parse_quoted());
+			} else if (at('*')) {
+				++i;
+				steps.emplace_back(WILDCARD);
+			} else if (at('?')) {
+				++i;
+				parse_filter();
+			} else {
+				step s(INDEX);
+				s.has_start = parse_int(s.start);
+				skip_ws();
+				if (at(':')) {
+					s.op = SLICE;
+					++i;
+					s.has_end = parse_int(s.end);
+					skip_ws();
+					if (at(':')) {
+						++i;
+						if (!parse_int(s.stride)) s.stride = 1;
+					}
+				} else if (!s.has_start) {
+					fail("Expected index, slice, name, '*' or filter");
+				}
+				steps.push_back(std::move(s));
+			}
+			expect(']');
+		}
+
+		// evaluation
+
+		static bool compare(const smoljson& node, compare_op op, const scalar& literal) {
+			int order = 0; // <0, 0, >0 like strcmp
+			if (node.type == NUMBER && literal.type == NUMBER) {
+				double a = node.number_value();
+				order = a < literal.number ? -1 : a > literal.number ? 1 : 0;
+			} else if (node.type == STRING && literal.type == STRING) {
+				order = node.string_value().compare(literal.str);
+			} else if (node.type == literal.type && (node.type == BOOLEAN || node.type == NULL_TYPE)) {
+				bool equal = node.type == NULL_TYPE || std::get<bool>(node.value) == literal.boolean;
+				if (op == EQ) return equal;
+				if (op == NE) return !equal;
+				return false;
+			} else {
+				return op == NE; // different types never compare equal or ordered
+			}
+
+			switch (op) {
+				case EQ: return order == 0;
+				case NE: return order != 0;
+				case LT: return order < 0;
+				case LE: return order <= 0;
+				case GT: return order > 0;
+				case GE: return order >= 0;
+				default: return true;
+			}
+		}
+
+		static void descend(const smoljson* node, std::vector<const smoljson*>& out) {
+			out.push_back(node);
+			if (node->type == ARRAY) {
+				for (const smoljson& item : node->array_value()) descend(&item, out);
+			} else if (node->type == OBJECT) {
+				for (const auto& [key, val_ptr] : node->object_value()) descend(val_ptr.get(), out);
+			}
+		}
+
+		template<typename Visit>
+		static void for_each_child(const smoljson* node, Visit visit) {
+			if (node->type == ARRAY) {
+				for (const smoljson& item : node->array_value()) visit(&item);
+			} else if (node->type == OBJECT) {
+				for (const auto& [key, val_ptr] : node->object_value()) visit(val_ptr.get());
+			}
+		}
+
+		void apply(const step& s, const smoljson* node, std::vector<const smoljson*>& out) const {
+			switch (s.op) {
+				case CHILD: {
+					if (node->type != OBJECT) return;
+					const object_t& map = node->object_value();
+					auto it = map.find(s.key, s.hash);
+					if (it != map.end()) out.push_back(it->second.get());
+					return;
+				}
+				case WILDCARD:
+					for_each_child(node, [&](const smoljson* child) { out.push_back(child); });
+					return;
+				case DESCEND:
+					descend(node, out);
+					return;
+				case FILTER:
+					for_each_child(node, [&](const smoljson* child) {
+						if (passes(s, *child)) out.push_back(child);
+					});
+					return;
+				case INDEX: {
+					if (node->type != ARRAY) return;
+					const array_t& arr = node->array_value();
+					long long len = static_cast<long long>(arr.size());
+					long long index = s.start < 0 ? s.start + len : s.start;
+					if (index >= 0 && index < len) out.push_back(&arr[index]);
+					return;
+				}
+				case SLICE: {
+					if (node->type != ARRAY || s.stride == 0) return;
+					const array_t& arr = node->array_value();
+					long long len = static_cast<long long>(arr.size());
+					auto normalize = [&](long long v, long long lo, long long hi) {
+						if (v < 0) v += len;
+						return std::clamp(v, lo, hi);
+					};
+					if (s.stride > 0) {
+						long long from = s.has_start ? normalize(s.start, 0, len) : 0;
+						long long to = s.has_end ? normalize(s.end, 0, len) : len;
+						for (long long k = from; k < to; k += s.stride) out.push_back(&arr[k]);
+					} else {
+						long long from = s.has_start ? normalize(s.start, -1, len - 1) : len - 1;
+						long long to = s.has_end ? normalize(s.end, -1, len - 1) : -1;
+						for (long long k = from; k > to; k += s.stride) out.push_back(&arr[k]);
+					}
+					return;
+				}
+			}
+		}
+
+	public:
+		explicit path(std::string_view expression) : expr(expression) {
+			skip_ws();
+			if (!at('$')) fail("JSONPath must start with '$'");
+			++i;
+
+			while (true) {
+				skip_ws();
+				if (i >= expr.size()) break;
+
+				if (at('[')) {
+					parse_bracket();
+				} else if (at('.')) {
+					++i;
+					if (at('.')) {
+						++i;
+						steps.emplace_back(DESCEND);
+						if (at('[')) continue; // ..[0] / ..['name']
+					}
+					if (at('*')) {
+						++i;
+						steps.emplace_back(WILDCARD);
+					} else {
+						add_child(parse_name());
+					}
+				} else {
+					fail("Unexpected character");
+				}
+			}
+			expr = {}; // the expression does not need to outlive compilation
+		}
+
+		std::vector<const smoljson*> select(const smoljson& doc) const { return select_from(doc, 0); }
+
+		// runs the query over raw json text without building a tree and calls
+		// on_match(const smoljson&) for every match in document order (select()
+		// orders recursive descent matches step by step instead). only the
+		// matched values are parsed, everything else is skipped by scanning.
+		// elements tested by a filter and arrays indexed/sliced from the end
+		// have to be parsed to decide. if on_match returns bool, false stops.
+		// the text is not fully validated, throws std::runtime_error when the
+		// scan runs into malformed json
+		template<typename Callback>
+		void stream(std::string_view text, Callback on_match) const {
+			stream_input input;
+			input.data = text.data();
+			input.size = text.size();
+			streamer<Callback>(*this, input, on_match).run();
+		}
+
+		// same for an istream that is read in chunks, only the current chunk
+		// and the value being matched are kept in memory
+		template<typename Callback>
+		void stream(std::istream& in, Callback on_match, size_t chunk_size = 1 << 16) const {
+			stream_input input;
+			input.in = &in;
+			input.chunk_size = chunk_size;
+			streamer<Callback>(*this, input, on_match).run();
+		}
+
+	private:
+		std::vector<const smoljson*> select_from(const smoljson& node, size_t first_step) const {
+			std::vector<const smoljson*> current{ &node }, next;
+			for (size_t k = first_step; k < steps.size(); k++) {
+				next.clear();
+				for (const smoljson* n : current) apply(steps[k], n, next);
+				std::swap(current, next);
+				if (current.empty()) break;
+			}
+			return current;
+		}
+
+		// streaming keeps the set of steps that are active at the current
+		// node as a bitmask, bit steps.size() means the node itself matches
+
+		static uint64_t bit(size_t k) { return uint64_t(1) << k; }
+
+		// indexing from the end needs the array length, so the array is parsed
+		bool needs_tree(const step& s) const {
+			return (s.op == INDEX && s.start < 0)
+				|| (s.op == SLICE && (s.stride < 0 || (s.has_start && s.start < 0) || (s.has_end && s.end < 0)));
+		}
+
+		// a descent step also applies to the node it is active on
+		uint64_t closure(uint64_t active) const {
+			for (size_t k = 0; k < steps.size(); k++) {
+				if ((active & bit(k)) && steps[k].op == DESCEND) active |= bit(k + 1);
+			}
+			return active;
+		}
+
+		uint64_t member_states(uint64_t active, std::string_view key) const {
+			uint64_t child = 0;
+			for (size_t k = 0; k < steps.size(); k++) {
+				if (!(active & bit(k))) continue;
+				const step& s = steps[k];
+				if (s.op == DESCEND) child |= bit(k);
+				else if (s.op == WILDCARD || (s.op == CHILD && s.key == key)) child |= bit(k + 1);
+			}
+			return child;
+		}
+
+		uint64_t element_states(uint64_t active, long long index) const {
+			uint64_t child = 0;
+			for (size_t k = 0; k < steps.size(); k++) {
+				if (!(active & bit(k))) continue;
+				const step& s = steps[k];
+				bool hit = false;
+				switch (s.op) {
+					case DESCEND: child |= bit(k); break;
+					case WILDCARD: hit = true; break;
+					case INDEX: hit = index == s.start; break;
+					case SLICE: {
+						long long from = s.has_start ? s.start : 0;
+						hit = s.stride > 0 && index >= from && (!s.has_end || index < s.end) && (index - from) % s.stride == 0;
+						break;
+					}
+					default: break;
+				}
+				if (hit) child |= bit(k + 1);
+			}
+			return child;
+		}
+
+		uint64_t filter_states(uint64_t active) const {
+			uint64_t filters = 0;
+			for (size_t k = 0; k < steps.size(); k++) {
+				if ((active & bit(k)) && steps[k].op == FILTER) filters |= bit(k);
+			}
+			return filters;
+		}
+
+		struct stream_input {
+			std::istream* in = nullptr;
+			size_t chunk_size = 0;
+			std::string storage;
+			const char* data = nullptr;
+			size_t size = 0;
+			size_t pos = 0;
+			size_t keep = static_cast<size_t>(-1); // start of a capture, survives refills
+
+			bool refill() {
+				if (!in || !*in) return false;
+				size_t from = keep < pos ? keep : pos;
+				storage.erase(0, from);
+				pos -= from;
+				if (keep != static_cast<size_t>(-1)) keep -= from;
+
+				size_t old = storage.size();
+				storage.resize(old + chunk_size);
+				in->read(&storage[old], static_cast<std::streamsize>(chunk_size));
+				storage.resize(old + static_cast<size_t>(in->gcount()));
+				data = storage.data();
+				size = storage.size();
+				return size > old;
+			}
+
+			int peek() { return (pos < size || refill()) ? static_cast<unsigned char>(data[pos]) : -1; }
+		};
+
+		template<typename Callback>
+		struct streamer {
+			const path& query;
+			stream_input& input;
+			Callback& on_match;
+			bool stopped = false;
+			std::string key_buffer;
+
+			static constexpr size_t none = static_cast<size_t>(-1);
+
+			streamer(const path& q, stream_input& in, Callback& callback) : query(q), input(in), on_match(callback) {}
+
+			[[noreturn]] void fail(const char* message) const {
+				SMOLJSON_THROW(std::runtime_error(concat(message, " at position ", std::to_string(input.pos), " while streaming JSONPath")));
+			}
+
+			static bool is_ws(int c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+			void skip_ws() { while (is_ws(input.peek())) ++input.pos; }
+
+			void expect(char c, const char* message) {
+				skip_ws();
+				if (input.peek() != c) fail(message);
+				++input.pos;
+			}
+
+			// the shared string scanner, resumed after a refill where the
+			// chunk cut the string off
+			void skip_string() {
+				++input.pos; // opening quote
+				bool escaped = false;
+				while (true) {
+					error_code code = error_code::none;
+					input.pos = scan_string_body(std::string_view(input.data, input.size), input.pos, false, escaped, code);
+					if (code == error_code::none) return;
+					if (code != error_code::unexpected_end) fail(error{ code, 0 }.message());
+					if (!input.refill()) fail("Unterminated string");
+				}
+			}
+
+			void skip_value() {
+				int c = input.peek();
+				if (c == '"') return skip_string();
+				if (c == '{' || c == '[') {
+					size_t depth = 0;
+					while (true) {
+						c = input.peek();
+						if (c < 0) fail("Unexpected end of input");
+						if (c == '"') {
+							skip_string();
+							continue;
+						}
+						++input.pos;
+						if (c == '{' || c == '[') ++depth;
+						else if ((c == '}' || c == ']') && --depth == 0) return;
+					}
+				}
+				if (c < 0) fail("Unexpected end of input");
+				while ((c = input.peek()) >= 0 && c != ',' && c != '}' && c != ']' && !is_ws(c)) ++input.pos;
+			}
+
+			smoljson capture_value() {
+				input.keep = input.pos;
+				skip_value();
+				std::string text(input.data + input.keep, input.pos - input.keep);
+				input.keep = none;
+				return smoljson::parse(text);
+			}
+
+			void report(const smoljson& match) {
+				if constexpr (std::is_same_v<decltype(on_match(match)), bool>) {
+					if (!on_match(match)) stopped = true;
+				} else {
+					on_match(match);
+				}
+			}
+
+			void report_from(const smoljson& node, size_t first_step) {
+				for (const smoljson* match : query.select_from(node, first_step)) {
+					if (stopped) return;
+					report(*match);
+				}
+			}
+
+			// a child that is tested by a filter has to be parsed, everything
+			// that is still active on it is then answered from the tree
+			void visit_parsed(uint64_t active, uint64_t filters) {
+				smoljson node = capture_value();
+				size_t n = query.steps.size();
+				if (active & bit(n)) report_from(node, n);
+				for (size_t k = 0; k < n; k++) {
+					if (active & bit(k)) report_from(node, k);
+					if ((filters & bit(k)) && query.passes(query.steps[k], node)) report_from(node, k + 1);
+				}
+			}
+
+			void visit(uint64_t active, uint64_t filters = 0) {
+				uint64_t direct = active; // the tree path does its own descent
+				active = query.closure(active);
+				skip_ws();
+
+				size_t n = query.steps.size();
+				bool tree = filters || (active & bit(n));
+				for (size_t k = 0; k < n && !tree; k++) {
+					tree = (active & bit(k)) && query.needs_tree(query.steps[k]);
+				}
+				if (tree) return visit_parsed(direct, filters);
+				if (!active) return skip_value();
+
+				uint64_t child_filters = query.filter_states(active);
+				int c = input.peek();
+				if (c == '{') {
+					++input.pos;
+					skip_ws();
+					if (input.peek() == '}') {
+						++input.pos;
+						return;
+					}
+					while (!stopped) {
+						skip_ws();
+						if (input.peek() != '"') fail("Expected string key");
+						uint64_t child = query.member_states(active, read_key());
+						expect(':', "Expected ':'");
+						visit(child, child_filters);
+						if (stopped) return;
+						skip_ws();
+						c = input.peek();
+						++input.pos;
+						if (c == '}') return;
+						if (c != ',') fail("Expected ',' or '}'");
+					}
+				} else if (c == '[') {
+					++input.pos;
+					skip_ws();
+					if (input.peek() == ']') {
+						++input.pos;
+						return;
+					}
+					for (long long index = 0; !stopped; index++) {
+						visit(query.element_states(active, index), child_filters);
+						if (stopped) return;
+						skip_ws();
+						c = input.peek();
+						++input.pos;
+						if (c == ']') return;
+						if (c != ',') fail("Expected ',' or ']'");
+					}
+				} else {
+					skip_value(); // scalars have no children to match
+				}
+			}
+
+			// the returned view is only valid until the input is read again
+			std::string_view read_key() {
+				input.keep = input.pos;
+				skip_string();
+				size_t start = input.keep;
+				input.keep = none;
+				std::string_view raw(input.data + start + 1, input.pos - start - 2);
+				if (raw.find('\\') == std::string_view::npos) return raw;
+				key_buffer = smoljson::parse(std::string(input.data + start, input.pos - start)).get<std::string>();
+				return key_buffer;
+			}
+
+			void run() {
+				if (query.steps.size() >= 64) SMOLJSON_THROW(std::invalid_argument("JSONPath has too many steps for streaming"));
+				visit(bit(0));
+			}
+		};
+
+		bool passes(const step& s, const smoljson& node) const {
+			const smoljson* operand = s.operand.resolve(node);
+			return operand && (s.cmp == EXISTS || compare(*operand, s.cmp, s.literal));
+		}
+	};
+
+	/// JSON SCHEMA
+
+	// JSON Schema (draft 2020-12 subset) compiled once into a flat program.
+	// every subschema becomes a node, a run of checks for just the keywords
+	// it uses. supported:
+	//   type enum const
+	//   minimum maximum exclusiveMinimum exclusiveMaximum multipleOf
+	//   minLength maxLength pattern
+	//   prefixItems items minItems maxItems
+	//   properties additionalProperties required minProperties maxProperties
+	//   allOf anyOf oneOf not, local $ref ("#", "#/$defs/name")
+	// anything else is ignored. validate() checks a tree, validate_text()
+	// checks raw text without building one. throws std::invalid_argument
+	// for schemas it can not compile
+	class schema {
+		enum op_code {
+			FAIL, TYPE, ENUM, CONST,
+			MINIMUM, MAXIMUM, EXCLUSIVE_MINIMUM, EXCLUSIVE_MAXIMUM, MULTIPLE_OF,
+			MIN_LENGTH, MAX_LENGTH, PATTERN,
+			PREFIX_ITEMS, ITEMS, MIN_ITEMS, MAX_ITEMS,
+			PROPERTIES, REQUIRED, MIN_PROPERTIES, MAX_PROPERTIES,
+			ALL_OF, ANY_OF, ONE_OF, NOT
+		};
+
+		static constexpr const char* keyword_names[] = {
+			"false", "type", "enum", "const",
+			"minimum", "maximum", "exclusiveMinimum", "exclusiveMaximum", "multipleOf",
+			"minLength", "maxLength", "pattern",
+			"prefixItems", "items", "minItems", "maxItems",
+			"properties", "required", "minProperties", "maxProperties",
+			"allOf", "anyOf", "oneOf", "not"
+		};
+
+		enum type_bits : uint32_t { T_NULL = 1, T_BOOLEAN = 2, T_NUMBER = 4, T_INTEGER = 8, T_STRING = 16, T_ARRAY = 32, T_OBJECT = 64 };
+
+		static constexpr uint32_t allow = static_cast<uint32_t>(-1); // additionalProperties: true
+		static constexpr uint32_t deny = static_cast<uint32_t>(-2);  // additionalProperties: false
+
+		struct check {
+			op_code op;
+			double number;  // limits
+			uint32_t a, b;  // type mask, node, or [a, b) range into the tables below
+			uint32_t extra; // PROPERTIES: additionalProperties node, allow or deny
+		};
+
+		struct node { uint32_t begin, end; }; // range in program
+
+		struct property {
+			std::string key;
+			uint64_t hash;
+			uint32_t node; // unused for REQUIRED
+		};
+
+		std::vector<check> program;
+		std::vector<node> nodes; // nodes[0] is the root
+		std::vector<uint32_t> children;    // ALL_OF, ANY_OF, ONE_OF, PREFIX_ITEMS
+		std::vector<property> properties;  // PROPERTIES, REQUIRED
+		std::vector<smoljson> constants;   // ENUM, CONST
+		std::vector<std::regex> patterns;  // PATTERN
+
+		// compiler
+
+		const smoljson* document = nullptr;
+		std::vector<std::pair<const smoljson*, uint32_t>> compiled; // subschemas seen so far, for $ref cycles
+
+		[[noreturn]] static void fail(const char* message, std::string_view detail) {
+			SMOLJSON_THROW(std::invalid_argument(concat(message, ": ", detail)));
+		}
+
+		static uint32_t type_mask(std::string_view name) {
+			if (name == "null") return T_NULL;
+			if (name == "boolean") return T_BOOLEAN;
+			if (name == "number") return T_NUMBER | T_INTEGER;
+			if (name == "integer") return T_INTEGER;
+			if (name == "string") return T_STRING;
+			if (name == "array") return T_ARRAY;
+			if (name == "object") return T_OBJECT;
+			fail("Unknown type in schema", name);
+		}
+
+		const smoljson& resolve_ref(const std::string& target) const {
+			if (target == "#") return *document;
+			if (target.compare(0, 2, "#/") != 0) fail("Only local $ref is supported", target);
+			const smoljson* found = pointer(target.substr(1)).resolve(*document);
+			if (!found) fail("Unresolved $ref", target);
+			return *found;
+		}
+
+		uint32_t compile(const smoljson& s) {
+			for (const auto& [seen, id] : compiled) {
+				if (seen == &s) return id;
+			}
+			uint32_t id = static_cast<uint32_t>(nodes.size());
+			nodes.push_back(node{0, 0});
+			compiled.emplace_back(&s, id);
+
+			// subschemas are compiled first so their checks don't end up inside this node
+			std::vector<check> local;
+			auto add = [&](op_code op, double number, uint32_t a = 0, uint32_t b = 0, uint32_t extra = 0) {
+				local.push_back(check{op, number, a, b, extra});
+			};
+			auto add_list = [&](op_code op, const smoljson& list) {
+				std::vector<uint32_t> ids;
+				for (const smoljson& item : list.elements()) ids.push_back(compile(item));
+				uint32_t first = static_cast<uint32_t>(children.size());
+				children.insert(children.end(), ids.begin(), ids.end());
+				add(op, 0, first, static_cast<uint32_t>(children.size()));
+			};
+			auto limit = [&](const char* keyword, op_code op) {
+				if (const smoljson* v = s.find(keyword)) add(op, v->get<double>());
+			};
+
+			if (s.type == BOOLEAN) {
+				if (!std::get<bool>(s.value)) add(FAIL, 0);
+			} else if (s.type == OBJECT) {
+				if (const smoljson* type = s.find("type")) {
+					uint32_t mask = 0;
+					if (type->is_array()) {
+						for (const smoljson& name : type->elements()) mask |= type_mask(name.get<std::string_view>());
+					} else {
+						mask = type_mask(type->get<std::string_view>());
+					}
+					add(TYPE, 0, mask);
+				}
+				if (const smoljson* e = s.find("enum")) {
+					uint32_t first = static_cast<uint32_t>(constants.size());
+					for (const smoljson& item : e->elements()) constants.push_back(item);
+					add(ENUM, 0, first, static_cast<uint32_t>(constants.size()));
+				}
+				if (const smoljson* c = s.find("const")) {
+					constants.push_back(*c);
+					add(CONST, 0, static_cast<uint32_t>(constants.size() - 1));
+				}
+
+				limit("minimum", MINIMUM);
+				limit("maximum", MAXIMUM);
+				limit("exclusiveMinimum", EXCLUSIVE_MINIMUM);
+				limit("exclusiveMaximum", EXCLUSIVE_MAXIMUM);
+				if (const smoljson* m = s.find("multipleOf")) {
+					if (m->get<double>() <= 0) fail("multipleOf has to be positive", m->serialize());
+					add(MULTIPLE_OF, m->get<double>());
+				}
+
+				limit("minLength", MIN_LENGTH);
+				limit("maxLength", MAX_LENGTH);
+				if (const smoljson* pattern = s.find("pattern")) {
+					patterns.emplace_back(pattern->get<std::string>(), std::regex::ECMAScript);
+					add(PATTERN, 0, static_cast<uint32_t>(patterns.size() - 1));
+				}
+
+				// older drafts spell prefixItems as an array valued items
+				const smoljson* prefix = s.find("prefixItems");
+				const smoljson* items = s.find("items");
+				if (items && items->is_array()) std::swap(prefix, items);
+				uint32_t prefix_count = 0;
+				if (prefix) {
+					add_list(PREFIX_ITEMS, *prefix);
+					prefix_count = static_cast<uint32_t>(prefix->size());
+				}
+				if (items) add(ITEMS, 0, compile(*items), prefix_count);
+				limit("minItems", MIN_ITEMS);
+				limit("maxItems", MAX_ITEMS);
+
+				const smoljson* props = s.find("properties");
+				const smoljson* additional = s.find("additionalProperties");
+				if (props || additional) {
+					std::vector<property> entries;
+					if (props) {
+						for (auto [key, sub] : props->items()) entries.push_back(property{std::string(key), hash_key(key), compile(sub)});
+					}
+					uint32_t extra = allow;
+					if (additional && additional->type == BOOLEAN) extra = std::get<bool>(additional->value) ? allow : deny;
+					else if (additional) extra = compile(*additional);
+					uint32_t first = static_cast<uint32_t>(properties.size());
+					properties.insert(properties.end(), entries.begin(), entries.end());
+					add(PROPERTIES, 0, first, static_cast<uint32_t>(properties.size()), extra);
+				}
+				if (const smoljson* required = s.find("required")) {
+					uint32_t first = static_cast<uint32_t>(properties.size());
+					for (const smoljson& key : required->elements()) {
+						properties.push_back(property{key.get<std::string>(), hash_key(key.get<std::string_view>()), allow});
+					}
+					add(REQUIRED, 0, first, static_cast<uint32_t>(properties.size()));
+				}
+				limit("minProperties", MIN_PROPERTIES);
+				limit("maxProperties", MAX_PROPERTIES);
+
+				if (const smoljson* ref = s.find("$ref")) {
+					uint32_t target = compile(resolve_ref(ref->get<std::string>()));
+					children.push_back(target);
+					add(ALL_OF, 0, static_cast<uint32_t>(children.size() - 1), static_cast<uint32_t>(children.size()));
+				}
+				if (const smoljson* all = s.find("allOf")) add_list(ALL_OF, *all);
+				if (const smoljson* any = s.find("anyOf")) add_list(ANY_OF, *any);
+				if (const smoljson* one = s.find("oneOf")) add_list(ONE_OF, *one);
+				if (const smoljson* n = s.find("not")) add(NOT, 0, compile(*n));
+			} else {
+				fail("Schema has to be an object or a boolean", s.serialize());
+			}
+
+			nodes[id] = node{static_cast<uint32_t>(program.size()), static_cast<uint32_t>(program.size() + local.size())};
+			program.insert(program.end(), local.begin(), local.end());
+			return id;
+		}
+
+		// evaluation
+
+		struct failure {
+			const char* keyword = nullptr;
+			std::string where; // json pointer, built while unwinding
+		};
+
+		static void blame(failure* f, op_code op) {
+			if (f && !f->keyword) f->keyword = keyword_names[op];
+		}
+
+		static void blame_child(failure* f, std::string_view segment) {
+			if (!f) return;
+			std::string escaped = "/";
+			for (char c : segment) {
+				if (c == '~') escaped += "~0";
+				else if (c == '/') escaped += "~1";
+				else escaped += c;
+			}
+			f->where.insert(0, escaped);
+		}
+
+		static std::string describe(const failure& f) {
+			return concat(f.keyword ? f.keyword : "schema", " failed at ", f.where.empty() ? std::string_view("the root") : std::string_view(f.where));
+		}
+
+		static uint32_t type_of(const smoljson& v) {
+			switch (v.type) {
+				case NULL_TYPE: return T_NULL;
+				case BOOLEAN: return T_BOOLEAN;
+				case NUMBER: {
+					double d = v.number_value();
+					return std::floor(d) == d && std::isfinite(d) ? T_NUMBER | T_INTEGER : T_NUMBER;
+				}
+				case STRING: return T_STRING;
+				case ARRAY: return T_ARRAY;
+				case OBJECT: return T_OBJECT;
+			}
+			return 0;
+		}
+
+		static bool equal(const smoljson& a, const smoljson& b) {
+			if (a.type != b.type) return false;
+			switch (a.type) {
+				case NULL_TYPE: return true;
+				case BOOLEAN: return std::get<bool>(a.value) == std::get<bool>(b.value);
+				case NUMBER: return a.number_value() == b.number_value();
+				case STRING: return a.string_value() == b.string_value();
+				case ARRAY: {
+					const array_t& x = a.array_value();
+					const array_t& y = b.array_value();
+					if (x.size() != y.size()) return false;
+					for (size_t i = 0; i < x.size(); ++i) {
+						if (!equal(x[i], y[i])) return false;
+					}
+					return true;
+				}
+				case OBJECT: {
+					const object_t& x = a.object_value();
+					const object_t& y = b.object_value();
+					if (x.size() != y.size()) return false;
+					for (const auto& [key, val_ptr] : x) {
+						auto it = y.find(key);
+						if (it == y.end() || !equal(*val_ptr, *it->second)) return false;
+					}
+					return true;
+				}
+			}
+			return false;
+		}
+
+		static size_t utf8_length(std::string_view s) {
+			size_t count = 0;
+			for (char c : s) count += (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+			return count;
+		}
+
+		static bool multiple_of(double x, double m) {
+			double q = x / m;
+			return std::fabs(q - std::round(q)) <= 1e-9 * std::max(1.0, std::fabs(q));
+		}
+
+		const property* find_property(const check& c, std::string_view key, uint64_t hash) const {
+			for (uint32_t k = c.a; k < c.b; ++k) {
+				if (properties[k].hash == hash && properties[k].key == key) return &properties[k];
+			}
+			return nullptr;
+		}
+
+		// checks that only look at the value itself, shared by both evaluators.
+		// count is the number of items/members for containers
+		bool passes_local(const check& c, uint32_t type, const smoljson* scalar, size_t count) const {
+			switch (c.op) {
+				case FAIL: return false;
+				case TYPE: return (c.a & type) != 0;
+				case MINIMUM: return !(type & T_NUMBER) || scalar->number_value() >= c.number;
+				case MAXIMUM: return !(type & T_NUMBER) || scalar->number_value() <= c.number;
+				case EXCLUSIVE_MINIMUM: return !(type & T_NUMBER) || scalar->number_value() > c.number;
+				case EXCLUSIVE_MAXIMUM: return !(type & T_NUMBER) || scalar->number_value() < c.number;
+				case MULTIPLE_OF: return !(type & T_NUMBER) || multiple_of(scalar->number_value(), c.number);
+				case MIN_LENGTH: return type != T_STRING || utf8_length(scalar->string_value()) >= c.number;
+				case MAX_LENGTH: return type != T_STRING || utf8_length(scalar->string_value()) <= c.number;
+				case PATTERN: return type != T_STRING || std::regex_search(scalar->string_value(), patterns[c.a]);
+				case MIN_ITEMS: return type != T_ARRAY || count >= c.number;
+				case MAX_ITEMS: return type != T_ARRAY || count <= c.number;
+				case MIN_PROPERTIES: return type != T_OBJECT || count >= c.number;
+				case MAX_PROPERTIES: return type != T_OBJECT || count <= c.number;
+				default: return true;
+			}
+		}
+
+		bool run(uint32_t id, const smoljson& v, failure* f) const {
+			uint32_t type = type_of(v);
+			size_t count = v.type == ARRAY ? v.array_value().size() : v.type == OBJECT ? v.object_value().size() : 0;
+			const node& n = nodes[id];
+			for (uint32_t k = n.begin; k < n.end; ++k) {
+				const check& c = program[k];
+				bool ok = true;
+				switch (c.op) {
+					case ENUM: {
+						ok = false;
+						for (uint32_t e = c.a; e < c.b && !ok; ++e) ok = equal(v, constants[e]);
+						break;
+					}
+					case CONST: ok = equal(v, constants[c.a]); break;
+					case PREFIX_ITEMS:
+					case ITEMS: {
+						if (type != T_ARRAY) break;
+						const array_t& arr = v.array_value();
+						size_t from = c.op == ITEMS ? c.b : 0;
+						size_t to = c.op == ITEMS ? arr.size() : std::min<size_t>(arr.size(), c.b - c.a);
+						for (size_t i = from; i < to && ok; ++i) {
+							ok = run(c.op == ITEMS ? c.a : children[c.a + i], arr[i], f);
+							if (!ok) blame_child(f, std::to_string(i));
+						}
+						break;
+					}
+					case PROPERTIES: {
+						if (type != T_OBJECT) break;
+						for (const auto& [key, val_ptr] : v.object_value()) {
+							const property* p = find_property(c, key, hash_key(key));
+							uint32_t target = p ? p->node : c.extra;
+							if (target == deny) {
+								blame_child(f, key);
+								if (f && !f->keyword) f->keyword = "additionalProperties";
+								ok = false;
+							} else if (target != allow && !run(target, *val_ptr, f)) {
+								blame_child(f, key);
+								ok = false;
+							}
+							if (!ok) break;
+						}
+						break;
+					}
+					case REQUIRED: {
+						if (type != T_OBJECT) break;
+						const object_t& map = v.object_value();
+						for (uint32_t r = c.a; r < c.b && ok; ++r) ok = map.find(properties[r].key, properties[r].hash) != map.end();
+						break;
+					}
+					case ALL_OF: {
+						for (uint32_t r = c.a; r < c.b && ok; ++r) ok = run(children[r], v, f);
+						break;
+					}
+					case ANY_OF: {
+						ok = false;
+						for (uint32_t r = c.a; r < c.b && !ok; ++r) ok = run(children[r], v, nullptr);
+						break;
+					}
+					case ONE_OF: {
+						size_t matches = 0;
+						for (uint32_t r = c.a; r < c.b && matches < 2; ++r) matches += run(children[r], v, nullptr);
+						ok = matches == 1;
+						break;
+					}
+					case NOT: ok = !run(c.a, v, nullptr); break;
+					default: ok = passes_local(c, type, &v, count); break;
+				}
+				if (!ok) {
+					blame(f, c.op);
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// validates the value at the parser position against several nodes
+		// in one pass, ok[k] is the result for nodes[k]. containers are
+		// streamed, each child is visited once with the union of the nodes
+		// that apply to it. scalars (and anything an enum/const has to
+		// compare) are parsed on their own and checked with run(). returns
+		// false only on a syntax error. failures are reported for nodes[0]
+		bool visit(parser& p, const std::vector<uint32_t>& targets, std::vector<char>& ok, failure* f) const {
+			p.skip_whitespace();
+			if (p.i >= p.json.size()) return p.fail(error_code::unexpected_end);
+			char c = p.json[p.i];
+
+			// combinators look at the same value, pull them into the set
+			std::vector<uint32_t> active(targets);
+			bool needs_tree = c != '[' && c != '{';
+			auto index_of = [&](uint32_t id) { return static_cast<size_t>(std::find(active.begin(), active.end(), id) - active.begin()); };
+			for (size_t k = 0; k < active.size() && !needs_tree; ++k) {
+				const node& n = nodes[active[k]];
+				for (uint32_t x = n.begin; x < n.end; ++x) {
+					const check& chk = program[x];
+					if (chk.op == ENUM || chk.op == CONST) needs_tree = true;
+					else if (chk.op == ALL_OF || chk.op == ANY_OF || chk.op == ONE_OF) {
+						for (uint32_t r = chk.a; r < chk.b; ++r) {
+							if (index_of(children[r]) == active.size()) active.push_back(children[r]);
+						}
+					} else if (chk.op == NOT && index_of(chk.a) == active.size()) {
+						active.push_back(chk.a);
+					}
+				}
+			}
+
+			if (needs_tree) {
+				smoljson value;
+				if (!p.parse_value(value)) return false;
+				for (size_t k = 0; k < targets.size(); ++k) ok[k] = run(targets[k], value, k == 0 ? f : nullptr);
+				return true;
+			}
+
+			std::vector<char> local(active.size(), 1);
+			auto reject = [&](size_t k, op_code op) {
+				if (k == 0 && local[0]) blame(f, op);
+				local[k] = 0;
+			};
+
+			// child nodes for the next value, links[i] says which active node asked for child_nodes[slot]
+			struct link { size_t k, slot; };
+			std::vector<uint32_t> child_nodes;
+			std::vector<link> links;
+			std::vector<char> child_ok;
+			auto want = [&](size_t k, uint32_t id) {
+				size_t slot = std::find(child_nodes.begin(), child_nodes.end(), id) - child_nodes.begin();
+				if (slot == child_nodes.size()) child_nodes.push_back(id);
+				links.push_back(link{k, slot});
+			};
+			auto visit_child = [&](std::string_view segment) {
+				if (child_nodes.empty()) return p.skip_value();
+				child_ok.assign(child_nodes.size(), 1);
+				// nodes[0]'s child, if any, is always slot 0 because its links come first
+				bool report = f && local[0] && !links.empty() && links[0].k == 0;
+				if (!visit(p, child_nodes, child_ok, report ? f : nullptr)) return false;
+				for (const link& l : links) {
+					if (child_ok[l.slot]) continue;
+					if (l.k == 0 && report && local[0]) blame_child(f, segment);
+					local[l.k] = 0;
+				}
+				return true;
+			};
+
+			size_t count = 0;
+			uint32_t type = c == '[' ? T_ARRAY : T_OBJECT;
+			std::vector<size_t> required_base(active.size());
+			std::vector<char> seen;
+			if (type == T_OBJECT) {
+				for (size_t k = 0; k < active.size(); ++k) {
+					required_base[k] = seen.size();
+					const node& n = nodes[active[k]];
+					for (uint32_t x = n.begin; x < n.end; ++x) {
+						if (program[x].op == REQUIRED) seen.resize(seen.size() + program[x].b - program[x].a, 0);
+					}
+				}
+			}
+
+			++p.i;
+			p.skip_whitespace();
+			char close = type == T_ARRAY ? ']' : '}';
+			if (p.is_char(close)) {
+				++p.i;
+			} else {
+				std::string scratch;
+				while (true) {
+					child_nodes.clear();
+					links.clear();
+					if (type == T_ARRAY) {
+						for (size_t k = 0; k < active.size(); ++k) {
+							const node& n = nodes[active[k]];
+							for (uint32_t x = n.begin; x < n.end; ++x) {
+								const check& chk = program[x];
+								if (chk.op == PREFIX_ITEMS && count < chk.b - chk.a) want(k, children[chk.a + count]);
+								if (chk.op == ITEMS && count >= chk.b) want(k, chk.a);
+							}
+						}
+						if (!visit_child(std::to_string(count))) return false;
+					} else {
+						if (p.i >= p.json.size()) return p.fail(error_code::unexpected_end);
+						if (p.json[p.i] != '"') return p.fail(error_code::expected_key);
+						std::string_view key;
+						if (!p.read_key(key, scratch)) return false;
+						std::string key_copy(key); // scratch is reused by nested objects
+						p.skip_whitespace();
+						if (p.i >= p.json.size()) return p.fail(error_code::unexpected_end);
+						if (p.json[p.i] != ':') return p.fail(error_code::expected_colon);
+						++p.i;
+
+						uint64_t hash = hash_key(key_copy);
+						for (size_t k = 0; k < active.size(); ++k) {
+							const node& n = nodes[active[k]];
+							size_t required_slot = required_base[k];
+							for (uint32_t x = n.begin; x < n.end; ++x) {
+								const check& chk = program[x];
+								if (chk.op == PROPERTIES) {
+									const property* prop = find_property(chk, key_copy, hash);
+									uint32_t target = prop ? prop->node : chk.extra;
+									if (target == deny) {
+										if (k == 0 && local[0] && f && !f->keyword) {
+											f->keyword = "additionalProperties";
+											blame_child(f, key_copy);
+										}
+										local[k] = 0;
+									} else if (target != allow) {
+										want(k, target);
+									}
+								} else if (chk.op == REQUIRED) {
+									for (uint32_t r = chk.a; r < chk.b; ++r, ++required_slot) {
+										if (properties[r].hash == hash && properties[r].key == key_copy) seen[required_slot] = 1;
+									}
+								}
+							}
+						}
+						if (!visit_child(key_copy)) return false;
+					}
+					++count;
+
+					p.skip_whitespace();
+					if (p.is_char(',')) { ++p.i; p.skip_whitespace(); continue; }
+					if (p.is_char(close)) { ++p.i; break; }
+					if (p.i >= p.json.size()) return p.fail(error_code::unexpected_end);
+					return p.fail(type == T_ARRAY ? error_code::expected_array_end : error_code::expected_object_end);
+				}
+			}
+
+			// checks on the container itself
+			for (size_t k = 0; k < active.size(); ++k) {
+				const node& n = nodes[active[k]];
+				size_t required_slot = required_base[k];
+				for (uint32_t x = n.begin; x < n.end; ++x) {
+					const check& chk = program[x];
+					if (chk.op == REQUIRED) {
+						if (type != T_OBJECT) continue;
+						for (uint32_t r = chk.a; r < chk.b; ++r, ++required_slot) {
+							if (!seen[required_slot]) reject(k, REQUIRED);
+						}
+					} else if (!passes_local(chk, type, nullptr, count)) {
+						reject(k, chk.op);
+					}
+				}
+			}
+
+			// fold the combinators back in, 0 unknown, 1 pass, 2 fail, 3 in progress
+			std::vector<char> state(active.size(), 0);
+			auto resolve = [&](auto& self, size_t k) -> bool {
+				if (state[k] == 3) return true; // a cycle on the same value, nothing left to check
+				if (state[k]) return state[k] == 1;
+				state[k] = 3;
+				bool pass = local[k] != 0;
+				const node& n = nodes[active[k]];
+				for (uint32_t x = n.begin; x < n.end && pass; ++x) {
+					const check& chk = program[x];
+					if (chk.op == ALL_OF || chk.op == ANY_OF || chk.op == ONE_OF) {
+						size_t matches = 0;
+						for (uint32_t r = chk.a; r < chk.b; ++r) matches += self(self, index_of(children[r]));
+						size_t total = chk.b - chk.a;
+						pass = chk.op == ALL_OF ? matches == total : chk.op == ANY_OF ? matches > 0 : matches == 1;
+					} else if (chk.op == NOT) {
+						pass = !self(self, index_of(chk.a));
+					}
+					if (!pass && k == 0) blame(f, chk.op);
+				}
+				state[k] = pass ? 1 : 2;
+				return pass;
+			};
+			for (size_t k = 0; k < targets.size(); ++k) ok[k] = resolve(resolve, k);
+			return true;
+		}
+
+	public:
+		explicit schema(const smoljson& doc) : document(&doc) {
+			compile(doc);
+			document = nullptr;
+			compiled.clear();
+		}
+
+		explicit schema(std::string_view text) : schema(smoljson::parse(text)) {}
+		explicit schema(const char* text) : schema(std::string_view(text)) {}
+
+		bool validate(const smoljson& doc) const { return run(0, doc, nullptr); }
+
+		// failure names the keyword and where it failed, e.g. "minimum failed at /age"
+		bool validate(const smoljson& doc, std::string& failure_out) const {
+			failure f;
+			if (run(0, doc, &f)) return true;
+			failure_out = describe(f);
+			return false;
+		}
+
+		// same checks straight on text, no tree is built for containers.
+		// malformed json fails with the parse error
+		bool validate_text(std::string_view json) const {
+			std::string ignored;
+			return validate_text(json, ignored);
+		}
+
+		bool validate_text(std::string_view json, std::string& failure_out) const {
+			parse_options options;
+			error err;
+			parser p(json, options, err);
+			std::vector<char> ok(1, 0);
+			failure f;
+			p.skip_whitespace(); // exactly one value, like parse()
+			if (!visit(p, std::vector<uint32_t>{0}, ok, &f) || !p.at_end()) {
+				failure_out = err.describe(json);
+				return false;
+			}
+			if (!ok[0]) failure_out = describe(f);
+			return ok[0] != 0;
+		}
+	};
+
+	/// WRITER
+
+	// push-style writer that emits json straight into a string, no tree needed.
+	// uses the same escaping and number formatting as serialize(). debug builds
+	// throw std::logic_error on calls that would produce invalid nesting
+	class writer;
+
+private:
+
+	// user types can take over writing with to_json(smoljson::writer&, const T&)
+	template<typename T, typename = void> struct has_to_json : std::false_type {};
+	template<typename T> struct has_to_json<T, std::void_t<decltype(to_json(std::declval<writer&>(), std::declval<const T&>()))>> : std::true_type {};
+
+	template<typename T>
+	static constexpr bool is_typed_v = has_to_json<T>::value || has_fields<T>::value || is_optional<T>::value
+		|| is_unique_ptr<T>::value || container_traits<T>::sequence || container_traits<T>::mapping;
+
+public:
+
+	class writer {
+		std::string owned;
+		std::string& out;
+		bool first = true; // nothing written yet on the current level
+		bool after_key = false;
+		// open brackets for the debug checks. the member is there in every
+		// build so the layout does not depend on NDEBUG, only the checks do
+		std::vector<char> nesting;
+
+		void check(bool ok, const char* message) const {
+			if (!ok) SMOLJSON_THROW(std::logic_error(message));
+		}
+
+		void check_value() const {
+			if (nesting.empty()) check(first, "Only one top-level value can be written");
+			else if (nesting.back() == '{') check(after_key, "Object values need a key first");
+		}
+
+		void separate() {
+#ifndef NDEBUG
+			check_value();
+#endif
+			if (!first && !after_key) out.push_back(',');
+			first = false;
+			after_key = false;
+		}
+
+		writer& open(char bracket) {
+			separate();
+#ifndef NDEBUG
+			nesting.push_back(bracket);
+#endif
+			out.push_back(bracket);
+			first = true;
+			return *this;
+		}
+
+		writer& close(char bracket) {
+#ifndef NDEBUG
+			check(!nesting.empty() && nesting.back() == (bracket == '}' ? '{' : '['), "Mismatched end of object/array");
+			check(!after_key, "Key without a value");
+			nesting.pop_back();
+#endif
+			out.push_back(bracket);
+			first = false;
+			return *this;
+		}
+
+	public:
+		writer() : out(owned) {}
+		explicit writer(std::string& target) : out(target) {} // appends to target
+
+		writer(const writer&) = delete;
+		writer& operator=(const writer&) = delete;
+
+		writer& begin_object() { return open('{'); }
+		writer& end_object() { return close('}'); }
+		writer& begin_array() { return open('['); }
+		writer& end_array() { return close(']'); }
+
+		writer& key(std::string_view k) {
+#ifndef NDEBUG
+			check(!nesting.empty() && nesting.back() == '{' && !after_key, "Keys are only allowed directly inside objects");
+#endif
+			if (!first) out.push_back(',');
+			string_sink sink{out};
+			write_escaped(sink, k);
+			out.push_back(':');
+			after_key = true;
+			return *this;
+		}
+
+		// key that is already escaped and followed by ':', one append
+		writer& quoted_key(std::string_view quoted) {
+#ifndef NDEBUG
+			check(!nesting.empty() && nesting.back() == '{' && !after_key, "Keys are only allowed directly inside objects");
+#endif
+			if (!first) out.push_back(',');
+			out.append(quoted);
+			after_key = true;
+			return *this;
+		}
+
+		writer& value(std::nullptr_t) { separate(); out.append("null", 4); return *this; }
+		writer& value(bool b) { separate(); b ? out.append("true", 4) : out.append("false", 5); return *this; }
+		writer& value(const char* s) { return value(std::string_view(s)); }
+		writer& value(const std::string& s) { return value(std::string_view(s)); }
+
+		writer& value(std::string_view s) {
+			separate();
+			string_sink sink{out};
+			write_escaped(sink, s);
+			return *this;
+		}
+
+		template<typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+		writer& value(T num) {
+			separate();
+			string_sink sink{out};
+			write_number(sink, static_cast<double>(num));
+			return *this;
+		}
+
+		// embeds an existing tree
+		writer& value(const smoljson& json) {
+			separate();
+			string_sink sink{out};
+			json.write_json(sink);
+			return *this;
+		}
+
+		// structs with SMOLJSON_FIELDS or a to_json() overload, and
+		// containers/optionals/unique_ptrs of anything value() takes
+		template<typename T, typename = std::enable_if_t<is_typed_v<T>>>
+		writer& value(const T& v) {
+			if constexpr (has_to_json<T>::value) {
+				to_json(*this, v);
+			} else if constexpr (is_optional<T>::value || is_unique_ptr<T>::value) {
+				if (v) value(*v);
+				else value(nullptr);
+			} else if constexpr (container_traits<T>::sequence) {
+				begin_array();
+				for (const auto& item : v) value(item);
+				end_array();
+			} else if constexpr (container_traits<T>::mapping) {
+				begin_object();
+				for (const auto& [k, item] : v) key(k).value(item);
+				end_object();
+			} else {
+				begin_object();
+				std::apply([&](const auto&... f) {
+					(quoted_key(f.quoted).value(v.*f.member), ...);
+				}, field_table<T>::fields);
+				end_object();
+			}
+			return *this;
+		}
+
+		const std::string& str() const { return out; }
+	};
+
+	// writes a typed value (see writer::value()) without building a tree
+	template<typename T>
+	static std::string serialize(const T& v) {
+		std::string result;
+		writer w(result);
+		w.value(v);
+		return result;
+	}
+
+};
+
+namespace smoljson_literals {
+	constexpr smoljson::key operator""_key(const char* name, size_t len) {
+		return smoljson::key(std::string_view(name, len));
+	}
+}
 
-#endif
\ No newline at end of file
+#endif
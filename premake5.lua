@@ -12,6 +12,9 @@ workspace "smoljson"
       defines { "NDEBUG" }
       optimize "On"
 
+   filter "system:linux"
+      links { "pthread" } -- serialize_chunks() spawns threads
+
    filter {}
    
    targetdir "bin/%{cfg.buildcfg}"
@@ -41,4 +44,25 @@ project "benchmark"
    files {
       "./src/bench.cpp",
       "./include/**",
-   }
\ No newline at end of file
+   }
+project "smoljson-codegen"
+   kind "ConsoleApp"
+
+   language "C++"
+   cppdialect "C++17"
+
+   files {
+      "./src/codegen.cpp",
+      "./include/**",
+   }
+
+project "smoljson-index"
+   kind "ConsoleApp"
+
+   language "C++"
+   cppdialect "C++17"
+
+   files {
+      "./src/index.cpp",
+      "./include/**",
+   }
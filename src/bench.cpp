@@ -24,6 +24,27 @@ static std::string read_file_to_string(const std::string& filepath) {
     return content;
 }
 
+struct friend_entry {
+    int id = 0;
+    std::string name;
+};
+SMOLJSON_FIELDS(friend_entry, id, name)
+
+struct user {
+    int index = 0;
+    std::string guid;
+    bool isActive = false;
+    std::string balance;
+    int age = 0;
+    std::string name;
+    std::string email;
+    double latitude = 0;
+    double longitude = 0;
+    std::vector<std::string> tags;
+    std::vector<friend_entry> friends;
+};
+SMOLJSON_FIELDS(user, index, guid, isActive, balance, age, name, email, latitude, longitude, tags, friends)
+
 template <typename T>
 inline static T benchmark(const char* name, std::function<T()> func) {
 	auto start = std::chrono::high_resolution_clock::now();
@@ -48,21 +69,56 @@ inline static smoljson parse(const std::string& data) {
     });
 }
 
+inline static std::vector<user> parse_typed(const std::string& data) {
+    return benchmark<std::vector<user>>("parsing (typed)", [&]() {
+        return smoljson::parse_as<std::vector<user>>(data);
+    });
+}
+
+inline static smoljson parse_projected(const std::string& data) {
+    return benchmark<smoljson>("parsing (projected)", [&]() {
+        return smoljson::parse(data, smoljson::projection{ "/*/_id", "/*/email", "/*/age" });
+    });
+}
+
+inline static std::string serialize_typed(const std::vector<user>& users) {
+    return benchmark<std::string>("serializing (typed)", [&]() {
+        return smoljson::serialize(users);
+    });
+}
+
 inline static std::string serialize(const smoljson& d) {
     return benchmark<std::string>("serializing", [&]() {
         return d.serialize();
     });
 }
 
+inline static std::string serialize_parallel(const smoljson& d) {
+    return benchmark<std::string>("serializing (parallel)", [&]() {
+        return d.serialize_parallel();
+    });
+}
+
+inline static size_t query(const smoljson& d, const smoljson::path& path) {
+    return benchmark<size_t>("jsonpath query", [&]() {
+        return path.select(d).size();
+    });
+}
+
 int main() {
     std::string dummy_data = read_file_to_string("..\\benchmark.json");
     std::cout << "\n";
     try {
         std::ofstream result("test.json");
-        result << serialize(parse(dummy_data));
+        smoljson parsed = parse(dummy_data);
+        serialize_typed(parse_typed(dummy_data));
+        parse_projected(dummy_data);
+        serialize_parallel(parsed);
+        query(parsed, smoljson::path("$[?(@.isActive==true)].email"));
+        result << serialize(parsed);
     }
     catch (std::exception e) {
         std::cout << e.what();
     }
 	return 0;
-}
\ No newline at end of file
+}
\ No newline at end of file
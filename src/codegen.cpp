@@ -0,0 +1,424 @@
+// smoljson-codegen: turns a JSON Schema, or a sample document, into a header
+// with matching structs and SMOLJSON_FIELDS tables. parse_as<T>() and
+// serialize() then work on those structs without ever building a tree.
+//
+//   smoljson-codegen --schema message.schema.json --name message --out message.hpp
+//   smoljson-codegen --sample ../benchmark.json --name user --out user.hpp
+
+#include "smoljson.hpp"
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+
+struct type_info;
+using type_ptr = std::shared_ptr<type_info>;
+
+struct field_info {
+    std::string key;
+    type_ptr type;
+    bool optional = false; // missing from the input sometimes (or not required)
+};
+
+struct type_info {
+    enum kind_t { ANY, NULL_ONLY, BOOLEAN, INTEGER, NUMBER, STRING, ARRAY, OBJECT } kind = ANY;
+    bool nullable = false;
+    type_ptr items;                 // ARRAY
+    std::vector<field_info> fields; // OBJECT, in declaration order
+    std::string name;               // OBJECT, struct name if the schema gave one
+    std::string emitted;            // OBJECT, set once the struct was written
+};
+
+static type_ptr make_type(type_info::kind_t kind) {
+    auto t = std::make_shared<type_info>();
+    t->kind = kind;
+    return t;
+}
+
+static std::string read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file) throw std::runtime_error("Failed to open file: " + path);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    return ss.str();
+}
+
+/// SAMPLE INFERENCE
+
+// integers that survive the round trip through a double, bigger ones stay double
+static bool is_integer(double d) {
+    return std::floor(d) == d && std::fabs(d) < 9007199254740992.0;
+}
+
+static type_ptr merge(const type_ptr& a, const type_ptr& b);
+
+static type_ptr infer(const smoljson& value) {
+    if (value.is_null()) return make_type(type_info::NULL_ONLY);
+    if (value.try_get<bool>()) return make_type(type_info::BOOLEAN);
+    if (auto d = value.try_get<double>()) return make_type(is_integer(*d) ? type_info::INTEGER : type_info::NUMBER);
+    if (value.try_get<std::string_view>()) return make_type(type_info::STRING);
+
+    if (value.is_array()) {
+        auto t = make_type(type_info::ARRAY);
+        for (const smoljson& item : value.elements()) {
+            t->items = t->items ? merge(t->items, infer(item)) : infer(item);
+        }
+        if (!t->items) t->items = make_type(type_info::ANY);
+        return t;
+    }
+
+    auto t = make_type(type_info::OBJECT);
+    for (auto [key, member] : value.items()) {
+        t->fields.push_back(field_info{ std::string(key), infer(member), false });
+    }
+    return t;
+}
+
+static type_ptr merge(const type_ptr& a, const type_ptr& b) {
+    if (a->kind == type_info::NULL_ONLY || b->kind == type_info::NULL_ONLY) {
+        auto t = std::make_shared<type_info>(a->kind == type_info::NULL_ONLY ? *b : *a);
+        t->nullable = true;
+        return t;
+    }
+
+    auto t = make_type(a->kind);
+    t->nullable = a->nullable || b->nullable;
+
+    if (a->kind != b->kind) {
+        bool numeric = (a->kind == type_info::INTEGER || a->kind == type_info::NUMBER)
+            && (b->kind == type_info::INTEGER || b->kind == type_info::NUMBER);
+        t->kind = numeric ? type_info::NUMBER : type_info::ANY;
+        return t;
+    }
+
+    if (a->kind == type_info::ARRAY) {
+        t->items = merge(a->items, b->items);
+    } else if (a->kind == type_info::OBJECT) {
+        // union of both key sets, keys missing on either side become optional
+        for (const field_info& fa : a->fields) {
+            auto fb = std::find_if(b->fields.begin(), b->fields.end(), [&](const field_info& f) { return f.key == fa.key; });
+            if (fb == b->fields.end()) t->fields.push_back(field_info{ fa.key, fa.type, true });
+            else t->fields.push_back(field_info{ fa.key, merge(fa.type, fb->type), fa.optional || fb->optional });
+        }
+        for (const field_info& fb : b->fields) {
+            auto fa = std::find_if(a->fields.begin(), a->fields.end(), [&](const field_info& f) { return f.key == fb.key; });
+            if (fa == a->fields.end()) t->fields.push_back(field_info{ fb.key, fb.type, true });
+        }
+    }
+    return t;
+}
+
+/// JSON SCHEMA
+
+class schema_reader {
+    const smoljson& document;
+    std::map<std::string, type_ptr> definitions; // by $ref
+
+public:
+    explicit schema_reader(const smoljson& doc) : document(doc) {}
+
+    // the document itself is "#", so {"$ref": "#"} refers back to the root type
+    type_ptr resolve(const std::string& target) {
+        if (target.empty() || target[0] != '#') throw std::runtime_error("Only local $ref is supported: " + target);
+
+        auto known = definitions.find(target);
+        if (known != definitions.end()) return known->second;
+
+        const smoljson* resolved = smoljson::pointer(target.substr(1)).resolve(document);
+        if (!resolved) throw std::runtime_error("Unresolved $ref: " + target);
+        if (resolved->is_object() && resolved->contains("$ref")) { // alias, share the type
+            definitions[target] = make_type(type_info::ANY); // a cycle of aliases ends up free-form
+            return definitions[target] = resolve((*resolved)["$ref"].get<std::string>());
+        }
+
+        // registered before reading so recursive references through arrays terminate
+        auto t = std::make_shared<type_info>();
+        definitions[target] = t;
+        *t = *read(*resolved);
+        if (t->kind == type_info::OBJECT && t->name.empty() && target.size() > 1) t->name = target.substr(target.rfind('/') + 1);
+        return t;
+    }
+
+    type_ptr read(const smoljson& schema) {
+        if (!schema.is_object()) return make_type(type_info::ANY);
+
+        if (const smoljson* ref = schema.find("$ref")) return resolve(ref->get<std::string>());
+
+        type_ptr t;
+        bool nullable = false;
+        const smoljson* type = schema.find("type");
+        std::string kind;
+        if (type && type->is_array()) {
+            // ["string", "null"] is an optional string, anything wider is free-form
+            size_t kinds = 0;
+            for (const smoljson& item : type->elements()) {
+                if (item.get<std::string_view>() == "null") nullable = true;
+                else { kind = item.get<std::string>(); ++kinds; }
+            }
+            if (kinds != 1) kind.clear();
+        } else if (type) {
+            kind = type->get<std::string>();
+        } else if (schema.contains("properties")) {
+            kind = "object";
+        } else if (schema.contains("items")) {
+            kind = "array";
+        }
+
+        if (kind == "boolean") t = make_type(type_info::BOOLEAN);
+        else if (kind == "integer") t = make_type(type_info::INTEGER);
+        else if (kind == "number") t = make_type(type_info::NUMBER);
+        else if (kind == "string") t = make_type(type_info::STRING);
+        else if (kind == "array") {
+            t = make_type(type_info::ARRAY);
+            const smoljson* items = schema.find("items");
+            t->items = items ? read(*items) : make_type(type_info::ANY);
+        } else if (kind == "object" && schema.contains("properties")) {
+            t = make_type(type_info::OBJECT);
+            std::set<std::string> required;
+            if (const smoljson* req = schema.find("required")) {
+                for (const smoljson& item : req->elements()) required.insert(item.get<std::string>());
+            }
+            if (const smoljson* title = schema.find("title")) t->name = title->get<std::string>();
+            for (auto [key, property] : schema["properties"].items()) {
+                t->fields.push_back(field_info{ std::string(key), read(property), required.count(std::string(key)) == 0 });
+            }
+        } else {
+            t = make_type(type_info::ANY); // "null", objects without properties, unions
+        }
+
+        t->nullable = t->nullable || nullable;
+        return t;
+    }
+};
+
+/// EMITTER
+
+class emitter {
+    std::string out;
+    std::set<std::string> used_names;
+    std::set<std::string> forward; // structs named before they were complete
+    std::set<const type_info*> open; // structs whose members are being written
+    bool in_array = false;           // naming an element type, vectors take incomplete types
+
+    static bool is_keyword(const std::string& s) {
+        static const std::set<std::string> keywords = {
+            "alignas", "alignof", "and", "asm", "auto", "bool", "break", "case", "catch", "char", "class",
+            "const", "constexpr", "continue", "default", "delete", "do", "double", "else", "enum", "explicit",
+            "export", "extern", "false", "float", "for", "friend", "goto", "if", "inline", "int", "long",
+            "mutable", "namespace", "new", "noexcept", "not", "nullptr", "operator", "or", "private",
+            "protected", "public", "register", "return", "short", "signed", "sizeof", "static", "struct",
+            "switch", "template", "this", "throw", "true", "try", "typedef", "typename", "union", "unsigned",
+            "using", "virtual", "void", "volatile", "while", "xor"
+        };
+        return keywords.count(s) != 0;
+    }
+
+    // the member a key is stored in: "class" -> class_, "x-y" -> x_y, "1st" -> f_1st
+    static std::string member_name(const std::string& key) {
+        std::string name;
+        for (char c : key) name += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+        if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) name = "f_" + name;
+        if (is_keyword(name)) name += "_";
+        return name;
+    }
+
+    // a C++ string literal with the same bytes, anything unusual as octal
+    static std::string literal(std::string_view s) {
+        std::string result = "\"";
+        for (char c : s) {
+            unsigned char u = static_cast<unsigned char>(c);
+            if (c == '"' || c == '\\') { result += '\\'; result += c; }
+            else if (u >= 0x20 && u < 0x7F) result += c;
+            else {
+                char octal[5];
+                std::snprintf(octal, sizeof(octal), "\\%03o", u);
+                result += octal;
+            }
+        }
+        return result + "\"";
+    }
+
+    std::string unique_name(std::string base) {
+        std::string name;
+        for (char c : base) name += std::isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(std::tolower(static_cast<unsigned char>(c))) : '_';
+        if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0])) || is_keyword(name)) name = "t_" + name;
+
+        // a member may not share its name with its own type, keys are reserved up front
+        if (used_names.count(name)) name += "_type";
+        std::string candidate = name;
+        for (int n = 2; used_names.count(candidate); ++n) candidate = name + "_" + std::to_string(n);
+        used_names.insert(candidate);
+        return candidate;
+    }
+
+    // type of a member; nested structs are written out first
+    std::string type_name(const type_ptr& t, const std::string& suggested) {
+        switch (t->kind) {
+            case type_info::ANY:
+            case type_info::NULL_ONLY: return "smoljson";
+            case type_info::BOOLEAN: return "bool";
+            case type_info::INTEGER: return "int64_t";
+            case type_info::NUMBER: return "double";
+            case type_info::STRING: return "std::string";
+            case type_info::ARRAY: {
+                bool outer = in_array;
+                in_array = true;
+                std::string item = member_type(t->items, suggested + "_item", false);
+                in_array = outer;
+                return "std::vector<" + item + ">";
+            }
+            case type_info::OBJECT: return emit_struct(t, suggested);
+        }
+        return "smoljson";
+    }
+
+    std::string member_type(const type_ptr& t, const std::string& suggested, bool optional) {
+        bool incomplete = t->kind == type_info::OBJECT && open.count(t.get());
+        std::string name = type_name(t, suggested);
+        if (incomplete) forward.insert(name);
+        // a struct that contains itself (directly or through others) needs an
+        // indirection, vectors of incomplete types are fine as they are
+        if (incomplete && !in_array) return "std::unique_ptr<" + name + ">";
+        bool nullable = optional || t->nullable;
+        return nullable && name != "smoljson" ? "std::optional<" + name + ">" : name;
+    }
+
+public:
+    void reserve_keys(const type_ptr& t) {
+        if (t->kind == type_info::ARRAY) reserve_keys(t->items);
+        if (t->kind != type_info::OBJECT || !t->emitted.empty()) return;
+        t->emitted = "-"; // visiting, recursive schemas
+        for (const field_info& f : t->fields) {
+            used_names.insert(member_name(f.key));
+            reserve_keys(f.type);
+        }
+        t->emitted.clear();
+    }
+
+    std::string emit_struct(const type_ptr& t, const std::string& suggested) {
+        if (!t->emitted.empty()) return t->emitted;
+        std::string name = unique_name(t->name.empty() ? suggested : t->name);
+        t->emitted = name; // before the members, recursive refs can name it
+        open.insert(t.get());
+        bool outer = in_array;
+        in_array = false;
+
+        std::string body = "struct " + name + " {\n";
+        std::string keys, table;
+        bool plain = true; // every key is its own member name, SMOLJSON_FIELDS can spell it
+        std::set<std::string> members; // keys that are identifiers keep their own name
+        for (const field_info& f : t->fields) {
+            if (member_name(f.key) == f.key) members.insert(f.key);
+        }
+        for (const field_info& f : t->fields) {
+            std::string member = member_name(f.key);
+            std::string candidate = member;
+            for (int n = 2; member != f.key && members.count(candidate); ++n) candidate = member + "_" + std::to_string(n);
+            member = candidate;
+            members.insert(member);
+            plain = plain && member == f.key;
+
+            std::string type = member_type(f.type, f.key, f.optional);
+            std::string init;
+            if (type == "bool") init = " = false";
+            else if (type == "int64_t" || type == "double") init = " = 0";
+            body += "    " + type + " " + member + init + ";\n";
+            keys += ", " + member;
+            table += std::string(table.empty() ? "" : ",\n") + "        smoljson::make_field(" + literal(f.key) + ", "
+                + literal(smoljson(f.key).serialize() + ":") + ", &" + name + "::" + member + ")";
+        }
+        body += "};\n";
+        if (!keys.empty() && plain) {
+            body += "SMOLJSON_FIELDS(" + name + keys + ")\n";
+        } else if (!keys.empty()) {
+            // keys that are not identifiers, spelled out like SMOLJSON_FIELDS would
+            body += "constexpr auto smoljson_fields(const " + name + "*) {\n    return std::make_tuple(\n" + table + ");\n}\n";
+        }
+        out += body + "\n";
+
+        open.erase(t.get());
+        in_array = outer;
+        return name;
+    }
+
+    std::string header(const std::string& guard, const std::string& source) const {
+        return "// generated by smoljson-codegen from " + source + ", do not edit\n"
+            "#ifndef " + guard + "\n"
+            "#define " + guard + "\n\n"
+            "#include \"smoljson.hpp\"\n"
+            "#include <cstdint>\n"
+            "#include <memory>\n"
+            "#include <optional>\n"
+            "#include <string>\n"
+            "#include <vector>\n\n"
+            + declarations() + out +
+            "#endif\n";
+    }
+
+    void append(const std::string& text) { out += text; }
+
+private:
+    std::string declarations() const {
+        std::string result;
+        for (const std::string& name : forward) result += "struct " + name + ";\n";
+        return result.empty() ? result : result + "\n";
+    }
+};
+
+static int usage() {
+    std::cerr << "usage: smoljson-codegen (--schema <file> | --sample <file>) [--name <struct>] [--out <file>]\n";
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    std::string schema_path, sample_path, out_path, name = "root";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return usage();
+        if (arg == "--schema") schema_path = argv[++i];
+        else if (arg == "--sample") sample_path = argv[++i];
+        else if (arg == "--name") name = argv[++i];
+        else if (arg == "--out") out_path = argv[++i];
+        else return usage();
+    }
+    if (schema_path.empty() == sample_path.empty()) return usage();
+
+    try {
+        std::string source = schema_path.empty() ? sample_path : schema_path;
+        smoljson doc = smoljson::parse(read_file(source));
+        type_ptr root = schema_path.empty() ? infer(doc) : schema_reader(doc).resolve("#");
+
+        emitter e;
+        e.reserve_keys(root);
+        if (root->kind == type_info::OBJECT) {
+            root->name = name;
+            e.emit_struct(root, name);
+        } else if (root->kind == type_info::ARRAY && root->items->kind == type_info::OBJECT) {
+            // top level arrays of records: the record gets the name
+            root->items->name = name;
+            std::string record = e.emit_struct(root->items, name);
+            e.append("using " + record + "_list = std::vector<" + record + ">;\n\n");
+        } else {
+            throw std::runtime_error("The top level value has to be an object or an array of objects");
+        }
+
+        std::string guard = "SMOLJSON_GENERATED_";
+        for (char c : name) guard += std::isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(std::toupper(static_cast<unsigned char>(c))) : '_';
+        guard += "_HPP";
+
+        std::string text = e.header(guard, source.substr(source.find_last_of("/\\") + 1));
+        if (out_path.empty()) {
+            std::cout << text;
+        } else {
+            std::ofstream file(out_path, std::ios::out | std::ios::binary);
+            if (!file) throw std::runtime_error("Failed to open file: " + out_path);
+            file << text;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
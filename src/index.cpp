@@ -0,0 +1,94 @@
+// smoljson-index: records the byte offsets of every element of a top-level
+// array in a sidecar file (<file>.idx), then pages through the array using
+// it instead of scanning from the start every time.
+//
+//   smoljson-index --build ../benchmark.json [--nested]
+//   smoljson-index --get 1000 --count 10 ../benchmark.json
+
+#include "smoljson.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+static std::string read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file) throw std::runtime_error("Failed to open file: " + path);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    return ss.str();
+}
+
+static uint64_t file_size(std::ifstream& file) {
+    file.seekg(0, std::ios::end);
+    uint64_t size = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+    return size;
+}
+
+static uint64_t modified(const std::string& path) {
+    return static_cast<uint64_t>(std::filesystem::last_write_time(path).time_since_epoch().count());
+}
+
+static smoljson::offset_index build(const std::string& path, bool nested) {
+    uint64_t stamp = modified(path); // before reading, a write during the read makes it stale
+    smoljson::offset_index index = smoljson::offset_index::build(read_file(path), nested);
+    index.set_source_stamp(stamp);
+    std::ofstream out(smoljson::offset_index::sidecar_path(path), std::ios::out | std::ios::binary);
+    if (!(out << index)) throw std::runtime_error("Failed to write " + smoljson::offset_index::sidecar_path(path));
+    return index;
+}
+
+// the sidecar, rebuilt when it is missing or belongs to a different version
+// of the file. a stale sidecar is rebuilt the way it was built
+static smoljson::offset_index load(const std::string& path, std::ifstream& file) {
+    smoljson::offset_index index;
+    std::ifstream in(smoljson::offset_index::sidecar_path(path), std::ios::in | std::ios::binary);
+    if (in >> index && index.source_size_bytes() == file_size(file) && index.source_stamp() == modified(path)) return index;
+    std::cerr << "index missing or stale, rebuilding\n";
+    return build(path, index.nested());
+}
+
+static int usage() {
+    std::cerr << "usage: smoljson-index --build <file> [--nested]\n"
+                 "       smoljson-index --get <k> [--count <n>] <file>\n";
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    std::string path;
+    bool building = false, nested = false;
+    size_t first = 0, count = 1;
+    bool getting = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--nested") nested = true;
+        else if (arg == "--build" && i + 1 < argc) { building = true; path = argv[++i]; }
+        else if (arg == "--get" && i + 1 < argc) { getting = true; first = std::stoull(argv[++i]); }
+        else if (arg == "--count" && i + 1 < argc) count = std::stoull(argv[++i]);
+        else if (arg[0] != '-' && path.empty()) path = arg;
+        else return usage();
+    }
+    if (path.empty() || building == getting) return usage();
+
+    try {
+        if (building) {
+            smoljson::offset_index index = build(path, nested);
+            std::cout << index.size() << " elements indexed in " << smoljson::offset_index::sidecar_path(path) << "\n";
+            return 0;
+        }
+
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file) throw std::runtime_error("Failed to open file: " + path);
+        smoljson::offset_index index = load(path, file);
+        if (first >= index.size()) throw std::out_of_range("The array only has " + std::to_string(index.size()) + " elements");
+        for (const smoljson& element : index.parse_range(file, first, count)) {
+            std::cout << element.serialize() << "\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
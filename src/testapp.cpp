@@ -1,4 +1,5 @@
 #include <iostream>
+#include <sstream>
 #include "smoljson.hpp"
 
 void test_basic_construction() {
@@ -46,6 +47,62 @@ void test_index_access() {
     std::cout << "empty_array[0]: " << j["empty_array"][0].get<int>() << "\n\n";
 }
 
+void test_object_lookup() {
+    smoljson j = smoljson::object({ {"zebra", 1}, {"a_rather_long_key_name_past_sso", 2}, {"apple", 3} });
+    std::string_view key = "a_rather_long_key_name_past_sso";
+    const smoljson& cj = j;
+
+    std::cout << "Insertion order kept: " << j.serialize() << "\n";
+    std::cout << "string_view lookup: " << cj[key].get<int>() << "\n";
+    std::cout << "Erase apple: " << j.as_map().erase("apple") << " -> " << j.serialize() << "\n\n";
+}
+
+void test_key_literals() {
+    using namespace smoljson_literals;
+    static constexpr smoljson::key age("age");
+
+    smoljson j = smoljson::object({ {"name", "Bob"}, {"age", 41} });
+    j["email"_key] = "bob@example.com";
+
+    const smoljson& cj = j;
+    std::cout << "Compile-time keys: " << cj["name"_key].get<std::string>() << ", " << cj[age].get<int>()
+              << ", " << cj["email"].get<std::string>() << "\n\n";
+}
+
+void test_views() {
+    smoljson j = smoljson::parse(R"({"name": "a string that is longer than sso", "list": [1, 2, 3], "n": 5})");
+
+    std::string_view name = j["name"].get<std::string_view>();
+    const std::string& same = j["name"].get_ref<const std::string&>();
+    std::cout << "string_view: " << name << " (no copy: " << (name.data() == same.data()) << ")\n";
+
+    std::cout << "elements():";
+    for (const smoljson& item : j["list"].elements()) std::cout << " " << item.get<int>();
+    std::cout << "\nitems():";
+    for (auto [key, value] : j.items()) std::cout << " " << key << "=" << value.serialize();
+    std::cout << "\nitems() on a number is empty: " << j["n"].items().empty() << "\n\n";
+}
+
+void test_container_conversion() {
+    smoljson j = smoljson::parse(R"({"ints": [1, 2, "3"], "prices": {"apple": 1.5, "pear": "2.25"}, "missing": null})");
+
+    auto ints = j["ints"].get<std::vector<int>>();
+    auto first_two = j["ints"].get<std::array<int, 2>>();
+    auto prices = j["prices"].get<std::unordered_map<std::string, double>>();
+    auto missing = j["missing"].get<std::optional<int>>();
+    std::cout << "vector<int>: " << ints[0] << "," << ints[1] << "," << ints[2] << "\n";
+    std::cout << "array<int, 2>: " << first_two[0] << "," << first_two[1] << "\n";
+    std::cout << "unordered_map pear: " << prices["pear"] << "\n";
+    std::cout << "optional from null: " << missing.has_value() << "\n";
+
+    smoljson back = smoljson::object({
+        {"tags", std::vector<std::string>{"a", "b"}},
+        {"scores", std::map<std::string, int>{{"x", 1}, {"y", 2}}},
+        {"none", std::optional<int>()}
+    });
+    std::cout << "From containers: " << back.serialize() << "\n\n";
+}
+
 void test_copy_move() {
     smoljson original = smoljson::object({ {"key", "value"} });
     smoljson copy = original;
@@ -60,6 +117,8 @@ void test_get_vs_strict_get() {
 
     std::cout << "get<int> (should succeed): " << j.get<int>() << "\n";
     std::cout << "get<std::string> (should serialize): " << j.get<std::string>() << "\n";
+    std::cout << "get<double> from strings (like std::stod): " << smoljson("+5").get<double>() << " " << smoljson(" 2.5kg").get<double>()
+              << " " << smoljson("0x10").get<double>() << " " << smoljson("inf").get<double>() << " " << smoljson("1e999").get<double>() << "\n";
 
     try {
         std::cout << "strict_get<std::string> (should throw): ";
@@ -84,6 +143,393 @@ void test_parsing() {
     std::cout << "Access nested object: " << parsed["object"]["nested"].get<bool>() << "\n\n";
 }
 
+void test_serialized_size() {
+    smoljson j = smoljson::object({
+        {"text", "tab\there \"quoted\""},
+        {"pi", 3.14159},
+        {"list", smoljson::array({ 1, -20, 300, nullptr, false })}
+    });
+
+    std::string expected = j.serialize();
+    size_t size = j.serialized_size();
+    std::cout << "serialized_size: " << size << " (serialize().size(): " << expected.size() << ")\n";
+
+    std::vector<char> buffer(size);
+    size_t written = j.serialize_to(buffer.data(), buffer.size());
+    std::cout << "serialize_to matches serialize: " << (std::string(buffer.data(), written) == expected) << "\n";
+
+    try {
+        j.serialize_to(buffer.data(), size - 1);
+    } catch (const std::exception& e) {
+        std::cout << "Caught exception: " << e.what() << "\n";
+    }
+
+    std::cout << "\n";
+}
+
+void test_writer() {
+    smoljson::writer w;
+    w.begin_object()
+        .key("status").value("ok")
+        .key("code").value(200)
+        .key("items").begin_array()
+            .value(1.5).value(nullptr).value(true)
+            .begin_object().key("nested").value("yes").end_object()
+        .end_array()
+        .key("tree").value(smoljson::array({ "a", "b" }))
+    .end_object();
+
+    std::cout << "Writer output: " << w.str() << "\n";
+
+    try {
+        smoljson::writer bad;
+        bad.begin_object().value(1);
+    } catch (const std::exception& e) {
+        std::cout << "Caught exception: " << e.what() << "\n";
+    }
+
+    std::cout << "\n";
+}
+
+void test_parallel_serialize() {
+    smoljson big = smoljson::array({});
+    for (int i = 0; i < 5000; i++) {
+        big[i] = smoljson::object({ {"index", i}, {"name", "item"} });
+    }
+
+    std::vector<std::string> chunks = big.serialize_chunks(4);
+    std::cout << "Parallel chunks: " << chunks.size() << "\n";
+    std::cout << "serialize_parallel matches serialize: " << (big.serialize_parallel(4) == big.serialize()) << "\n";
+
+    smoljson::parse_options keep;
+    keep.keep_source = true;
+    smoljson verbatim = smoljson::parse(smoljson::reformat(big.serialize(), 2), keep);
+    std::cout << "serialize_parallel matches serialize (keep_source): " << (verbatim.serialize_parallel(4) == verbatim.serialize()) << "\n";
+
+    smoljson::parse_options lazy;
+    lazy.eager_depth = 0;
+    smoljson unexpanded = smoljson::parse(smoljson::reformat(big.serialize(), 2), lazy);
+    std::cout << "serialize_parallel matches serialize (lazy): " << (unexpanded.serialize_parallel(4) == unexpanded.serialize()) << "\n\n";
+}
+
+void test_serialize_cache() {
+    smoljson state = smoljson::parse(R"({"config":{"mode":"fast","limits":[1,2,3]},"stats":{"hits":0}})");
+    state.enable_serialize_cache();
+
+    std::cout << "Cached first: " << state.serialize() << "\n";
+    state["stats"]["hits"] = 42;
+    state["config"]["limits"][3] = 4;
+    std::string cached = state.serialize();
+    std::cout << "Cached after edits: " << cached << "\n";
+    // a reference from before the serialize still marks the cached text stale
+    smoljson& limits = state["config"]["limits"];
+    state.serialize();
+    limits[0] = 99;
+    cached = state.serialize();
+    std::cout << "Write through an older reference: " << cached << "\n";
+    state.enable_serialize_cache(false);
+    std::cout << "Matches uncached: " << (cached == state.serialize()) << "\n\n";
+}
+
+void test_keep_source() {
+    smoljson::parse_options options;
+    options.keep_source = true;
+
+    smoljson payload = smoljson::parse(R"({"untouched": {"price": 1.0, "tags": [ "a", "b" ]}, "edited": {"count": 1}})", options);
+    payload["edited"]["count"] = 2;
+
+    std::cout << "Verbatim passthrough: " << payload["untouched"].serialize() << "\n";
+    std::cout << "Edited subtree: " << payload["edited"].serialize() << "\n\n";
+}
+
+void test_lazy_scalars() {
+    smoljson::parse_options options;
+    options.lazy_scalars = true;
+
+    smoljson doc = smoljson::parse(R"({"id": 12345678901234567890, "price": 1.50, "name": "caf\u00e9", "city": "Graz"})", options);
+    const smoljson& view = doc;
+    std::cout << "Exact number text: " << view["id"].source_text() << "\n";
+    std::cout << "Decoded on read: " << view["name"].get<std::string>() << " " << view["price"].get<double>() << "\n";
+    std::cout << "Verbatim leaves: " << doc.serialize() << "\n";
+    std::cout << "Non-const get_ref: " << doc["city"].get_ref<const std::string&>() << "\n";
+    doc["price"] = 2;
+    std::cout << "After edit: " << doc.serialize() << " (source text now '" << view["price"].source_text() << "')\n";
+
+    smoljson::error lazy_err, eager_err;
+    smoljson::parse("[1e999]", options, lazy_err);
+    smoljson::parse("[1e999]", eager_err);
+    std::cout << "Out of range number: lazy '" << lazy_err.message() << "', eager '" << eager_err.message() << "'\n\n";
+}
+
+void test_lazy_subtrees() {
+    smoljson::parse_options options;
+    options.eager_depth = 1;
+
+    const smoljson doc = smoljson::parse(R"({"meta": {"page": 1}, "items": [{"id": 1, "tags": ["a"]}, {"id": 2, "tags": []}]})", options);
+    std::cout << "Unparsed subtree: " << doc["items"].source_text() << "\n";
+    std::cout << "Expanded on access: " << doc["items"][1]["id"].get<int>() << ", meta still unparsed: " << doc["meta"].source_text() << "\n";
+
+    smoljson broken = smoljson::parse(R"({"ok": true, "bad": [1,,2]})", options);
+    std::cout << "Untouched error: " << broken["ok"].get<bool>() << "\n";
+    try {
+        broken["bad"][0];
+    } catch (const std::exception& e) {
+        std::cout << "Error on expansion: " << e.what() << "\n";
+    }
+    broken["bad"] = "replaced"; // never expanded, so it can't fail
+    std::cout << "Replaced unexpanded subtree: " << broken.serialize() << "\n\n";
+}
+
+void test_projection() {
+    std::string records = R"([
+        {"_id": "a1", "age": 31, "email": "ann@example.com", "tags": ["x", "y"], "friends": [{"id": 0, "name": "Ben"}]},
+        {"_id": "b2", "age": 17, "email": "ben@example.com", "tags": [], "friends": []}
+    ])";
+
+    smoljson::projection keep({ "/*/_id", "/*/email", "/*/age" });
+    std::cout << "Projected: " << smoljson::parse(records, keep).serialize() << "\n";
+
+    smoljson::projection no_lists([](std::string_view key) { return key != "tags" && key != "friends"; });
+    std::cout << "Key predicate: " << smoljson::parse(records, no_lists)[1].serialize() << "\n";
+
+    smoljson::projection second({ "/1/friends" });
+    std::cout << "Index path: " << smoljson::parse(records, second).serialize() << "\n\n";
+}
+
+void test_offset_index() {
+    std::string dump = R"([{"id": 0, "tags": ["a"]}, {"id": 1, "tags": ["b", "c"]}, {"id": 2, "tags": []}])";
+
+    smoljson::offset_index index = smoljson::offset_index::build(dump, true);
+    std::stringstream sidecar;
+    sidecar << index;
+
+    smoljson::offset_index loaded;
+    sidecar >> loaded;
+    std::cout << "Indexed elements: " << loaded.size() << ", element 1: " << loaded.element(dump, 1) << "\n";
+    std::cout << "Parsed element 2: " << loaded.parse(dump, 2).serialize() << "\n";
+    std::cout << "Nested child 1/1: " << loaded.child(dump, 1, 1) << "\n";
+
+    std::stringstream file(dump);
+    std::cout << "Range from stream:";
+    for (const smoljson& element : loaded.parse_range(file, 1, 5)) std::cout << " " << element["id"].get<int>();
+    std::cout << "\n";
+
+    // a child offset past the end of its element, and an absurd element count
+    std::string bytes = sidecar.str();
+    std::string bad_child = bytes, bad_count = bytes;
+    bad_child[bad_child.size() - 1] = '\x7f';
+    bad_count[16] = '\x7f';
+    std::stringstream corrupt_child(bad_child), corrupt_count(bad_count);
+    std::cout << "Corrupt sidecars rejected: " << !(corrupt_child >> loaded) << " " << !(corrupt_count >> loaded) << "\n\n";
+}
+
+void test_incremental_reparse() {
+    std::string text = R"({"config": {"retries": 3, "hosts": ["a", "b"]}, "users": [{"name": "Ann"}, {"name": "Ben"}]})";
+    smoljson doc = smoljson::parse(text);
+    const smoljson* users = &doc["users"];
+
+    smoljson::text_edit edit;
+    edit.offset = text.find("3");
+    edit.removed = 1;
+    edit.inserted = "5";
+
+    smoljson::error err;
+    smoljson* changed = smoljson::reparse(doc, text, edit, err);
+    edit.apply(text);
+    std::cout << "Reparsed container: " << changed->serialize() << "\n";
+    std::cout << "Untouched subtree kept: " << (users == &doc["users"]) << "\n";
+
+    edit = smoljson::text_edit{ text.find("]"), 0, ", " };
+    std::cout << "Invalid edit: " << (smoljson::reparse(doc, text, edit, err) ? "applied" : err.message()) << ", tree unchanged: " << doc["config"].serialize() << "\n\n";
+}
+
+void test_json_pointer() {
+    smoljson doc = smoljson::parse(R"({"user":{"name":"Ann","address":{"city":"Graz","zip":"8010"}},"tags":["a","b"],"a/b":1})");
+
+    smoljson::pointer city("/user/address/city");
+    std::cout << "Pointer /user/address/city: " << city.resolve(doc)->serialize() << "\n";
+    std::cout << "Pointer /a~1b: " << smoljson::pointer("/a~1b").resolve(doc)->serialize() << "\n";
+
+    std::vector<smoljson::pointer> paths = {
+        smoljson::pointer("/user/address/zip"),
+        smoljson::pointer("/tags/1"),
+        smoljson::pointer("/user/missing"),
+        city
+    };
+    std::cout << "get_many:";
+    for (const smoljson* found : smoljson::get_many(doc, paths)) {
+        std::cout << " " << (found ? found->serialize() : "<missing>");
+    }
+    std::cout << "\n\n";
+}
+
+void test_jsonpath() {
+    smoljson people = smoljson::parse(R"([
+        {"name": "Ann", "isActive": true, "age": 31, "tags": ["a", "b"]},
+        {"name": "Ben", "isActive": false, "age": 17, "tags": ["c"]},
+        {"name": "Cid", "isActive": true, "age": 45, "tags": []}
+    ])");
+
+    for (const char* query : { "$[?(@.isActive==true)].name", "$[?(@.age < 18)].name", "$..tags[0]", "$[-1:].name", "$[*].tags.*" }) {
+        std::cout << "JSONPath " << query << ":";
+        for (const smoljson* match : smoljson::path(query).select(people)) {
+            std::cout << " " << match->serialize();
+        }
+        std::cout << "\n";
+    }
+
+    std::string raw = people.serialize();
+    std::cout << "Streamed $[*].name:";
+    smoljson::path("$[*].name").stream(raw, [](const smoljson& name) {
+        std::cout << " " << name.serialize();
+    });
+    std::cout << "\n";
+
+    try {
+        smoljson::path invalid("$.name[");
+    } catch (const std::exception& e) {
+        std::cout << "Caught exception: " << e.what() << "\n";
+    }
+
+    std::cout << "\n";
+}
+
+void test_unicode() {
+    smoljson j = smoljson::parse(R"(["caf\u00e9", "\u4e2d\u6587", "\ud83d\ude00", "\ud83d alone"])");
+    std::cout << "unicode escapes:";
+    for (const smoljson& s : j.elements()) std::cout << " " << s.get<std::string>();
+    std::cout << "\n";
+
+    smoljson::parse_options options;
+    options.validate_utf8 = true;
+    smoljson::error err;
+    smoljson::parse("\"bad \xC3\x28\"", options, err);
+    std::cout << "validate_utf8: " << err.message() << " at " << err.offset << "\n\n";
+}
+
+void test_validate() {
+    smoljson::error err;
+    std::cout << "validate well-formed: " << smoljson::validate(R"({"a": [1, 2.5e3, "x", null]})") << "\n";
+    smoljson::validate("[1, 2] trailing", err);
+    std::cout << "validate trailing data: " << err.message() << " at " << err.offset << "\n";
+
+    smoljson::validate_options options;
+    options.utf8 = true;
+    options.max_depth = 2;
+    smoljson::validate("[[[1]]]", options, err);
+    std::cout << "validate depth limit: " << err.message() << "\n";
+    smoljson::validate("\"\xC3\x28\"", options, err);
+    std::cout << "validate utf-8: " << err.message() << "\n";
+
+    // validate() and parse() share one grammar, eager and lazy parses alike
+    std::vector<std::string> corpus = {
+        R"({"a": [1, 2.5e3, "x", null]})", "[1, 2] trailing", "[[[1]]]", " 0 ", "-0", "01", "-01", "1.", ".5", "-",
+        "1e5", "1E+5", "1e", "1e999", "[1,]", "[1 2]", R"({"a" 1})", R"({"a": 1,})", R"({1: 2})", "tru", "nul",
+        R"("\u00e9\ud83d\ude00")", R"("\u12")", R"("\x")", "\"tab\there\"", "\"unterminated", "[", "{}", "[] []", ""
+    };
+    size_t agree = 0;
+    for (const std::string& text : corpus) {
+        smoljson::error eager, lazy;
+        smoljson::parse_options lazy_options;
+        lazy_options.lazy_scalars = true;
+        smoljson::parse(text, smoljson::parse_options{}, eager);
+        smoljson::parse(text, lazy_options, lazy);
+        bool valid = smoljson::validate(text);
+        if (valid == !eager && valid == !lazy) ++agree;
+        else std::cout << "disagree: " << text << "\n";
+    }
+    std::cout << "validate agrees with parse: " << agree << "/" << corpus.size() << "\n\n";
+}
+
+void test_minify() {
+    std::string text = "{ \"b\" : [ 1.50 , \"keep  spaces\" ],\n  \"a\": {} }";
+    std::cout << "minify: " << smoljson::minify(text) << "\n";
+    std::cout << "reformat:\n" << smoljson::reformat(text, 2) << "\n\n";
+}
+
+void test_json_schema() {
+    smoljson::schema user(R"({
+        "type": "object",
+        "required": ["name", "age"],
+        "properties": {
+            "name": {"type": "string", "minLength": 1},
+            "age": {"type": "integer", "minimum": 0},
+            "tags": {"type": "array", "items": {"enum": ["admin", "staff"]}}
+        },
+        "additionalProperties": false
+    })");
+
+    std::string failure;
+    std::cout << "Schema valid tree: " << user.validate(smoljson::parse(R"({"name": "Bob", "age": 41})")) << "\n";
+    user.validate(smoljson::parse(R"({"name": "Bob", "age": -1})"), failure);
+    std::cout << "Schema tree failure: " << failure << "\n";
+    user.validate_text(R"({"name": "Bob", "age": 41, "tags": ["admin", "root"]})", failure);
+    std::cout << "Schema text failure: " << failure << "\n";
+    std::cout << "Schema text extra key: " << user.validate_text(R"({"name": "Bob", "age": 41, "x": 1})") << "\n";
+    smoljson::schema any_object(R"({"type": "object"})");
+    std::cout << "Schema text trailing data: " << any_object.validate_text("{} xx", failure) << " (" << failure.substr(0, failure.find(" at")) << ")\n\n";
+}
+
+void test_non_throwing() {
+    smoljson::error err;
+    smoljson broken = smoljson::parse("[1, 2", err);
+    std::cout << "Error code parse: " << err.message() << " at " << err.offset << " (null result: " << broken.is_null() << ")\n";
+    std::cout << "Lazy context: " << err.describe("[1, 2") << "\n";
+
+    smoljson j = smoljson::parse(R"({"port": 8080, "host": "localhost"})", err);
+    std::cout << "contains(\"port\"): " << j.contains("port") << ", find(\"missing\"): " << (j.find("missing") == nullptr) << "\n";
+    std::cout << "try_get<std::string> on number: " << j["port"].try_get<std::string>().has_value() << "\n";
+    std::cout << "get_or<int>(80): " << j["port"].get_or<int>(80) << ", on string: " << j["host"].get_or<int>(80) << "\n\n";
+}
+
+struct pet {
+    std::string name;
+    int age = 0;
+};
+SMOLJSON_FIELDS(pet, name, age)
+
+struct owner {
+    std::string name;
+    std::optional<std::string> email;
+    std::vector<pet> pets;
+};
+SMOLJSON_FIELDS(owner, name, email, pets)
+
+void test_typed_parsing() {
+    owner o = smoljson::parse_as<owner>(R"({"id": 7, "name": "Bob", "pets": [{"name": "Rex", "age": 3, "breed": "?"}], "email": null})");
+    std::cout << "parse_as<owner>: " << o.name << ", email set: " << o.email.has_value()
+              << ", pets: " << o.pets.size() << " (" << o.pets[0].name << ", " << o.pets[0].age << ")\n";
+
+    smoljson::error err;
+    pet p;
+    smoljson::parse_into(R"({"name": "Rex", "age": "three"})", p, err);
+    std::cout << "parse_into type mismatch: " << err.message() << " at " << err.offset << "\n";
+    smoljson::parse_into(R"({"name": "Rex", "age": 1.5})", p, err);
+    std::cout << "parse_into fractional int: " << err.message() << " at " << err.offset << "\n";
+    smoljson::parse_into(R"({"name": "Rex", "age": 3e9})", p, err);
+    std::cout << "parse_into int out of range: " << err.message() << " at " << err.offset << "\n";
+    bool whole = smoljson::parse_into(R"({"name": "Rex", "age": 4.0})", p, err);
+    std::cout << "parse_into 4.0 as int: " << whole << " (" << p.age << ")\n\n";
+}
+
+struct temperature {
+    double celsius = 0;
+};
+
+void to_json(smoljson::writer& w, const temperature& t) {
+    w.value(std::to_string(static_cast<int>(t.celsius)) + "C");
+}
+
+void test_typed_writing() {
+    owner o{"Bob", std::nullopt, {{"Rex", 3}, {"Tom", 5}}};
+    std::cout << "serialize(owner): " << smoljson::serialize(o) << "\n";
+    std::cout << "to_json overload: " << smoljson::serialize(std::vector<temperature>{{21.5}, {-3}}) << "\n";
+
+    smoljson::writer w;
+    w.begin_object().key("owner").value(o).key("count").value(1).end_object();
+    std::cout << "writer.value(owner): " << w.str() << "\n\n";
+}
+
 void test_edge_cases() {
     smoljson j;
     try {
@@ -114,9 +560,32 @@ int main() {
     test_basic_construction();
     test_array_and_object();
     test_index_access();
+    test_object_lookup();
+    test_key_literals();
+    test_views();
+    test_container_conversion();
     test_copy_move();
     test_get_vs_strict_get();
     test_parsing();
+    test_serialized_size();
+    test_writer();
+    test_parallel_serialize();
+    test_serialize_cache();
+    test_keep_source();
+    test_lazy_scalars();
+    test_lazy_subtrees();
+    test_projection();
+    test_offset_index();
+    test_incremental_reparse();
+    test_json_pointer();
+    test_jsonpath();
+    test_unicode();
+    test_validate();
+    test_minify();
+    test_json_schema();
+    test_non_throwing();
+    test_typed_parsing();
+    test_typed_writing();
     test_edge_cases();
 
     std::cout << "All tests complete.\n";